@@ -0,0 +1,126 @@
+#ifndef __ALLOCPOLICY_H_
+#define __ALLOCPOLICY_H_
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <set>
+#include <cstdint>
+#include "freespace.h"
+#include "snapshot.h"
+
+enum AllocationPolicyType : uint8_t {FirstFit, NextFit, BestFit, WorstFit, SegregatedFit, BuddyFit};
+
+// Counters shared by every process using the same policy
+typedef struct AllocationStats {
+    uint64_t allocations;
+    uint64_t failures;
+    uint64_t releases;
+    uint64_t requested_bytes;
+    uint64_t reserved_bytes;
+    uint64_t live_requested_bytes;
+    uint64_t live_reserved_bytes;
+    uint64_t elapsed_ns;
+} AllocationStats;
+
+// Decides where in a process' heap a request is placed. Every policy takes
+// its blocks from the process' FreeSpaceIndex; policies that round requests
+// up (segregated fits, buddy) report the rounded size as the reserved size.
+class AllocationPolicy {
+public:
+    virtual ~AllocationPolicy() {}
+
+    virtual bool allocate(FreeSpaceIndex *free_space, uint32_t size, uint32_t *address, uint32_t *reserved) = 0;
+    virtual void release(FreeSpaceIndex *free_space, uint32_t address, uint32_t reserved) = 0;
+
+    // free bytes held by the policy itself rather than the free space index
+    virtual uint64_t getHeldBytes() { return 0; }
+    // copy with the same state, for a forked process whose heap is a copy
+    virtual AllocationPolicy* clone() = 0;
+    // state beyond the free space index, for snapshots
+    virtual void save(SnapshotWriter& out) {}
+    virtual bool load(SnapshotReader& in) { return true; }
+};
+
+class FirstFitPolicy : public AllocationPolicy {
+public:
+    bool allocate(FreeSpaceIndex *free_space, uint32_t size, uint32_t *address, uint32_t *reserved);
+    void release(FreeSpaceIndex *free_space, uint32_t address, uint32_t reserved);
+    AllocationPolicy* clone();
+};
+
+class NextFitPolicy : public AllocationPolicy {
+private:
+    uint32_t _rover;
+
+public:
+    NextFitPolicy();
+    bool allocate(FreeSpaceIndex *free_space, uint32_t size, uint32_t *address, uint32_t *reserved);
+    void release(FreeSpaceIndex *free_space, uint32_t address, uint32_t reserved);
+    AllocationPolicy* clone();
+    void save(SnapshotWriter& out);
+    bool load(SnapshotReader& in);
+};
+
+class BestFitPolicy : public AllocationPolicy {
+public:
+    bool allocate(FreeSpaceIndex *free_space, uint32_t size, uint32_t *address, uint32_t *reserved);
+    void release(FreeSpaceIndex *free_space, uint32_t address, uint32_t reserved);
+    AllocationPolicy* clone();
+};
+
+class WorstFitPolicy : public AllocationPolicy {
+public:
+    bool allocate(FreeSpaceIndex *free_space, uint32_t size, uint32_t *address, uint32_t *reserved);
+    void release(FreeSpaceIndex *free_space, uint32_t address, uint32_t reserved);
+    AllocationPolicy* clone();
+};
+
+// Power of two size classes with one free list per class. Freed blocks go
+// back on their class list instead of being coalesced; requests above the
+// largest class are placed first-fit in the free space index.
+class SegregatedFitPolicy : public AllocationPolicy {
+private:
+    std::vector<std::vector<uint32_t> > _classes;
+    uint64_t _held_bytes;
+
+    int sizeClass(uint32_t size);
+
+public:
+    SegregatedFitPolicy();
+    bool allocate(FreeSpaceIndex *free_space, uint32_t size, uint32_t *address, uint32_t *reserved);
+    void release(FreeSpaceIndex *free_space, uint32_t address, uint32_t reserved);
+    AllocationPolicy* clone();
+    uint64_t getHeldBytes();
+    void save(SnapshotWriter& out);
+    bool load(SnapshotReader& in);
+};
+
+// Binary buddy system over the largest power of two region that fits in the
+// heap, taken from the free space index on first use.
+class BuddyPolicy : public AllocationPolicy {
+private:
+    bool _initialized;
+    uint32_t _base;
+    int _max_order;
+    std::vector<std::set<uint32_t> > _free_blocks;
+    uint64_t _held_bytes;
+
+    bool initialize(FreeSpaceIndex *free_space);
+    int blockOrder(uint32_t size);
+
+public:
+    BuddyPolicy();
+    bool allocate(FreeSpaceIndex *free_space, uint32_t size, uint32_t *address, uint32_t *reserved);
+    void release(FreeSpaceIndex *free_space, uint32_t address, uint32_t reserved);
+    AllocationPolicy* clone();
+    uint64_t getHeldBytes();
+    void save(SnapshotWriter& out);
+    bool load(SnapshotReader& in);
+};
+
+AllocationPolicy* createAllocationPolicy(AllocationPolicyType type);
+AllocationPolicyType stringToAllocationPolicy(std::string text, bool *valid);
+std::string allocationPolicyToString(AllocationPolicyType type);
+
+#endif // __ALLOCPOLICY_H_
@@ -0,0 +1,132 @@
+#ifndef __ARENA_H_
+#define __ARENA_H_
+
+#include <iostream>
+#include <vector>
+#include <string_view>
+#include <new>
+#include <utility>
+#include <cstdint>
+
+// Arenas hand out memory from fixed size chunks, in 16 byte size classes
+#define ARENA_CHUNK_SIZE 4096
+#define ARENA_ALIGNMENT 16
+#define ARENA_SIZE_CLASSES (ARENA_CHUNK_SIZE / ARENA_ALIGNMENT)
+
+typedef struct ArenaChunk {
+    struct ArenaChunk *next;
+    alignas(ARENA_ALIGNMENT) char data[ARENA_CHUNK_SIZE];
+} ArenaChunk;
+
+// Chunks shared by all arenas of one Mmu. Chunks an arena gives back are
+// kept on a free list for the next arena instead of going back to the heap.
+class ChunkPool {
+private:
+    ArenaChunk *_free;
+    uint64_t _num_chunks;
+    uint64_t _free_chunks;
+
+public:
+    ChunkPool();
+    ~ChunkPool();
+
+    ArenaChunk* allocate();
+    void release(ArenaChunk *first, ArenaChunk *last, uint64_t count);
+
+    uint64_t getNumChunks();
+    uint64_t getFreeChunks();
+};
+
+// Bump allocator over a list of chunks with one free list per size class,
+// for the metadata of a single process. Blocks can be released one by one,
+// or all at once by handing the whole chunk list back to the pool.
+// Blocks larger than a chunk get their own heap allocation.
+class Arena {
+private:
+    typedef struct FreeBlock {
+        struct FreeBlock *next;
+    } FreeBlock;
+
+    ChunkPool *_pool;
+    ArenaChunk *_first;
+    ArenaChunk *_last;
+    uint64_t _num_chunks;
+    char *_next;
+    uint32_t _remaining;
+    FreeBlock *_free[ARENA_SIZE_CLASSES];
+    std::vector<void*> _large;
+
+public:
+    Arena(ChunkPool *pool);
+    ~Arena();
+
+    void *allocate(uint32_t size);
+    void release(void *block, uint32_t size);
+    void releaseAll();
+
+    // copies a name into the arena
+    std::string_view intern(std::string_view name);
+    void releaseName(std::string_view name);
+};
+
+// Fixed size objects carved from slabs of slab_size objects, reusing
+// destroyed objects through a free list. Slabs are only returned when the
+// pool goes away, so every object has to be destroyed before that.
+template <typename T>
+class ObjectPool {
+private:
+    typedef union Slot {
+        union Slot *next;
+        alignas(T) char object[sizeof(T)];
+    } Slot;
+
+    std::vector<Slot*> _slabs;
+    Slot *_free;
+    uint32_t _slab_size;
+
+public:
+    ObjectPool(uint32_t slab_size)
+    {
+        _free = NULL;
+        _slab_size = slab_size;
+    }
+
+    ~ObjectPool()
+    {
+        size_t i;
+        for (i = 0; i < _slabs.size(); i++)
+        {
+            delete[] _slabs[i];
+        }
+    }
+
+    template <typename... Args>
+    T* create(Args&&... args)
+    {
+        uint32_t i;
+        if (_free == NULL)
+        {
+            Slot *slab = new Slot[_slab_size];
+            for (i = 0; i < _slab_size; i++)
+            {
+                slab[i].next = (i + 1 < _slab_size) ? &slab[i + 1] : NULL;
+            }
+            _slabs.push_back(slab);
+            _free = slab;
+        }
+
+        Slot *slot = _free;
+        _free = slot->next;
+        return new (slot->object) T(std::forward<Args>(args)...);
+    }
+
+    void destroy(T *object)
+    {
+        object->~T();
+        Slot *slot = (Slot*)object;
+        slot->next = _free;
+        _free = slot;
+    }
+};
+
+#endif // __ARENA_H_
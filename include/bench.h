@@ -0,0 +1,13 @@
+#ifndef __BENCH_H_
+#define __BENCH_H_
+
+#include <cstdint>
+
+// Times that many calls to getPhysicalAddress, with no TLB in front of the
+// page table, for a sequential and a random access pattern. Each pattern
+// also runs against a map keyed on "<pid>|<page>" strings, the page table
+// before the radix tree, so one run shows both. Prints translations per
+// second and returns false if a translation failed.
+bool runTranslationBenchmark(int page_size, uint64_t translations);
+
+#endif // __BENCH_H_
@@ -0,0 +1,123 @@
+#ifndef __BINARYTRACE_H_
+#define __BINARYTRACE_H_
+
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <cstdio>
+#include "mmu.h"
+
+// Binary trace layout (version 2, reads version 1 as well):
+//   header:  "MSTR" <u8 version> <3 reserved bytes>
+//   records: <u8 opcode> followed by opcode specific fields. Integers are
+//            LEB128 varints (signed values zigzag encoded), floats and
+//            doubles are raw little endian. Variable names are interned: a
+//            TraceName record defines the next name id before its first use.
+//            Every name id has a current type, the one of the last allocate
+//            or set record naming it; a TraceSetSame record uses that type
+//            instead of storing its own.
+//   Lines that have no compact form (print, malformed commands, ...) are
+//   stored verbatim in TraceText records and replayed as text.
+#define TRACE_MAGIC   "MSTR"
+#define TRACE_VERSION 2
+
+enum TraceOpcode : uint8_t {
+    TraceEnd = 0x00,
+    TraceName = 0x01,       // <len> <bytes>
+    TraceCreate = 0x02,     // <text_size> <data_size>
+    TraceAllocate = 0x03,   // <pid> <name_id> <u8 type> <num_elements>
+    TraceSet = 0x04,        // <pid> <name_id> <offset> <u8 type> <count> <values...>
+    TraceFree = 0x05,       // <pid> <name_id>
+    TraceTerminate = 0x06,  // <pid>
+    TraceText = 0x07,       // <len> <bytes>
+    TraceSetSame = 0x08     // <pid> <name_id> <offset> <count> <values...>, read back as a TraceSet
+};
+
+typedef struct TraceRecord {
+    TraceOpcode opcode;
+    uint32_t pid;
+    uint32_t arg1;
+    uint32_t arg2;
+    DataType type;
+    std::string_view name;
+    std::string_view text;
+    const void *values; // count decoded elements of type, contiguous
+    uint32_t count;
+} TraceRecord;
+
+// Encodes text command lines into the binary format. Set values are encoded
+// with the type the variable was allocated with, which the writer tracks by
+// following create/allocate/free/terminate the same way the simulator does.
+// The writer can't tell whether an allocate succeeds, so a name allocated
+// again with another type before it is freed has an unknown type (FreeSpace)
+// and its sets stay text.
+class TraceWriter {
+private:
+    FILE *_file;
+    std::vector<uint8_t> _buffer;
+    std::unordered_map<std::string, uint32_t> _names;
+    std::vector<DataType> _name_types; // current type of each name id in the trace, FreeSpace if none
+    std::unordered_map<uint32_t, std::unordered_map<uint32_t, DataType> > _types;
+    uint32_t _next_pid;
+    std::vector<std::string_view> _tokens;
+
+    void putByte(uint8_t value);
+    void putVarint(uint64_t value);
+    void putSigned(int64_t value);
+    void putBytes(const void *data, size_t length);
+    uint32_t internName(std::string_view name);
+    void noteType(uint32_t pid, uint32_t name, DataType type);
+    void writeText(std::string_view line);
+    bool encodeSetValues(DataType type, size_t first);
+    void flushBuffer();
+
+public:
+    TraceWriter();
+    ~TraceWriter();
+
+    bool open(std::string path);
+    void writeLine(std::string_view line);
+    void close();
+};
+
+// Replays a binary trace straight from an mmap of the file. next fails both
+// at the end of the trace and on a record it can't decode; a trace that
+// stops without a TraceEnd record is truncated and counts as corrupt.
+class TraceReader {
+private:
+    const uint8_t *_data;
+    size_t _length;
+    size_t _position;
+    size_t _record_start;
+    bool _finished;
+    bool _corrupt;
+    std::vector<std::string_view> _names;
+    std::vector<DataType> _name_types;
+    std::vector<uint8_t> _values;
+
+    bool getByte(uint8_t *value);
+    bool getVarint(uint64_t *value);
+    bool getVarint32(uint32_t *value);
+    bool getSigned(int64_t *value);
+    bool getBytes(size_t length, const uint8_t **data);
+    bool getName(std::string_view *name, uint32_t *id);
+    bool decodeValues(TraceRecord *record);
+    bool readRecord(TraceRecord *record);
+
+public:
+    TraceReader();
+    ~TraceReader();
+
+    bool open(std::string path);
+    bool next(TraceRecord *record);
+    bool isCorrupt();
+    size_t getErrorOffset(); // file offset of the record that failed to decode
+};
+
+bool isBinaryTrace(std::string path);
+bool convertTrace(std::string text_path, std::string binary_path);
+
+#endif // __BINARYTRACE_H_
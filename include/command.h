@@ -0,0 +1,25 @@
+#ifndef __COMMAND_H_
+#define __COMMAND_H_
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include "mmu.h"
+
+enum CommandType : uint8_t {CmdUnknown, CmdCreate, CmdAllocate, CmdSet, CmdFree, CmdTerminate, CmdPrint, CmdExit, CmdFork, CmdAttach, CmdSnapshot, CmdRestore, NumCommandTypes};
+
+// Splits text on d into views of the original buffer ("..." groups a token)
+void tokenizeCommand(std::string_view text, char d, std::vector<std::string_view>& result);
+CommandType lookupCommand(std::string_view name);
+
+// Non-throwing number parsing; the whole token must be a number
+bool parseNumber(std::string_view text, int *value);
+bool parseNumber(std::string_view text, uint32_t *value);
+bool parseNumber(std::string_view text, long *value);
+bool parseNumber(std::string_view text, float *value);
+bool parseNumber(std::string_view text, double *value);
+
+bool stringToDataType(std::string_view text, DataType *type);
+
+#endif // __COMMAND_H_
@@ -0,0 +1,116 @@
+#ifndef __DATATYPE_H_
+#define __DATATYPE_H_
+
+#include <iostream>
+#include <string_view>
+#include <charconv>
+#include <cstring>
+#include <cstdint>
+
+// Every element type a variable can have: enum name, C++ type and the name
+// used by the allocate command. Adding a type is one line here.
+#define DATA_TYPES(X) \
+    X(Char,   char,   "char") \
+    X(Short,  short,  "short") \
+    X(Int,    int,    "int") \
+    X(Float,  float,  "float") \
+    X(Long,   long,   "long") \
+    X(Double, double, "double")
+
+#define DATA_TYPE_ENUM(name, ctype, text) name,
+enum DataType : uint8_t {FreeSpace, DATA_TYPES(DATA_TYPE_ENUM) NumDataTypes};
+#undef DATA_TYPE_ENUM
+
+// Size, alignment, parsing, formatting and unaligned load/store for one
+// element type
+template <typename T>
+struct ElementTraits {
+    static const uint32_t size = sizeof(T);
+    static const uint32_t alignment = alignof(T);
+
+    // the whole token must be a number
+    static bool parse(std::string_view text, T *value)
+    {
+        if (text.empty())
+        {
+            return false;
+        }
+        std::from_chars_result result = std::from_chars(text.data(), text.data() + text.length(), *value);
+        return result.ec == std::errc() && result.ptr == text.data() + text.length();
+    }
+
+    static void format(std::ostream& out, T value)
+    {
+        out << value;
+    }
+
+    static T load(const void *from)
+    {
+        T value;
+        memcpy(&value, from, sizeof(T));
+        return value;
+    }
+
+    static void store(void *to, T value)
+    {
+        memcpy(to, &value, sizeof(T));
+    }
+};
+
+// a char value is the first character of its token
+template <>
+inline bool ElementTraits<char>::parse(std::string_view text, char *value)
+{
+    if (text.empty())
+    {
+        return false;
+    }
+    *value = text[0];
+    return true;
+}
+
+// shorts are parsed as ints and truncated
+template <>
+inline bool ElementTraits<short>::parse(std::string_view text, short *value)
+{
+    int wide;
+    if (!ElementTraits<int>::parse(text, &wide))
+    {
+        return false;
+    }
+    *value = (short)wide;
+    return true;
+}
+
+template <typename T>
+struct TypeTag {
+    typedef T type;
+};
+
+// Calls visitor(TypeTag<T>()) with the C++ type behind a DataType, so a loop
+// written inside the visitor is specialized per type and branches only once.
+// FreeSpace and unknown values return a default constructed result.
+template <typename Visitor>
+auto visitDataType(DataType type, Visitor&& visitor) -> decltype(visitor(TypeTag<char>()))
+{
+    switch (type)
+    {
+#define DATA_TYPE_CASE(name, ctype, text) case name: return visitor(TypeTag<ctype>());
+        DATA_TYPES(DATA_TYPE_CASE)
+#undef DATA_TYPE_CASE
+        default:
+            return decltype(visitor(TypeTag<char>()))();
+    }
+}
+
+inline uint32_t dataTypeSize(DataType type)
+{
+    return visitDataType(type, [](auto tag) -> uint32_t { return ElementTraits<typename decltype(tag)::type>::size; });
+}
+
+inline uint32_t dataTypeAlignment(DataType type)
+{
+    return visitDataType(type, [](auto tag) -> uint32_t { return ElementTraits<typename decltype(tag)::type>::alignment; });
+}
+
+#endif // __DATATYPE_H_
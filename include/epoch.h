@@ -0,0 +1,48 @@
+#ifndef __EPOCH_H_
+#define __EPOCH_H_
+
+#include <iostream>
+#include <vector>
+#include <atomic>
+#include <functional>
+#include <cstdint>
+
+#define EPOCH_MAX_READERS 64
+
+// Epoch based reclamation for structures that readers walk without locks.
+// A reader publishes the epoch it entered in its own slot while it holds
+// pointers into the structure. The single writer unlinks memory, retires it
+// with the current epoch and moves the epoch on; retired memory is released
+// once every reader that entered before it was retired has left.
+class EpochManager {
+private:
+    typedef struct RetiredItem {
+        uint64_t epoch;
+        std::function<void()> release;
+    } RetiredItem;
+
+    std::atomic<uint64_t> _epoch;
+    std::atomic<uint64_t> _readers[EPOCH_MAX_READERS]; // entered epoch, 0 while outside
+    std::atomic<uint32_t> _num_readers;
+    std::vector<RetiredItem> _retired;
+    uint64_t _reclaimed;
+
+public:
+    EpochManager();
+    ~EpochManager();
+
+    // reader side, one slot per thread
+    int registerReader();
+    void enter(int reader);
+    void leave(int reader);
+
+    // writer side
+    void retire(std::function<void()> release);
+    void reclaim();
+    void synchronize();
+
+    uint64_t getPending();
+    uint64_t getReclaimed();
+};
+
+#endif // __EPOCH_H_
@@ -0,0 +1,71 @@
+#ifndef __FRAMEALLOCATOR_H_
+#define __FRAMEALLOCATOR_H_
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <cstdint>
+
+// Owns the simulated physical memory and hands out page sized frames from it.
+// Frame usage is tracked in a bitmap so allocation is a find-first-set over
+// 64 frame words, starting from the lowest word that may hold a free frame.
+//
+// An allocator built on top of a shared one is a frame cache for a single
+// thread: it takes frames from the shared bitmap in batches under its lock
+// and keeps the frames it frees, so threads rarely meet on the lock.
+//
+// Memory is an anonymous mapping, or a shared mapping of a file when one is
+// given, so the frames live on in the file after the simulator exits.
+class FrameAllocator {
+private:
+    void *_memory;
+    bool _mapped;
+    uint32_t _memory_size;
+    uint32_t _frame_size;
+    uint32_t _num_frames;
+    uint32_t _used_frames;
+    uint32_t _first_free_word;
+    std::vector<uint64_t> _used;
+
+    FrameAllocator *_shared;
+    std::vector<uint32_t> _cache;
+    uint32_t _batch_size;
+    std::mutex _lock;
+
+    int allocateFrame();
+    int allocateRunFrames(uint32_t count);
+    void releaseFrame(uint32_t frame);
+    uint32_t allocateBatch(uint32_t *frames, uint32_t count);
+    void releaseBatch(const uint32_t *frames, uint32_t count);
+
+public:
+    FrameAllocator(uint32_t memory_size, uint32_t frame_size, std::string path = "");
+    FrameAllocator(FrameAllocator *shared, uint32_t batch_size);
+    ~FrameAllocator();
+
+    int allocate();
+    int allocateRun(uint32_t count);
+    void release(uint32_t frame);
+    bool isAllocated(uint32_t frame);
+    bool claim(uint32_t frame);
+    void flushCache();
+
+    // Memory image of a snapshot at a page aligned offset of fd: frames in
+    // use are written, free ones left as holes. Mapping an image replaces
+    // memory with a private copy of the file that is read in on first touch.
+    bool writeImage(int fd, uint64_t offset);
+    bool mapImage(int fd, uint64_t offset);
+
+    bool isOpen();
+    void *getMemory();
+    uint32_t getMemorySize();
+    uint32_t getFrameSize();
+    uint32_t getNumFrames();
+    uint32_t getUsedFrames();
+    uint32_t getFreeFrames();
+
+    void print();
+};
+
+#endif // __FRAMEALLOCATOR_H_
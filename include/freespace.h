@@ -0,0 +1,67 @@
+#ifndef __FREESPACE_H_
+#define __FREESPACE_H_
+
+#include <iostream>
+#include <set>
+#include <vector>
+#include <utility>
+#include <cstdint>
+
+// Hole size histogram buckets: bucket b counts holes of [2^b, 2^(b+1)) bytes
+#define FREE_HISTOGRAM_BUCKETS 32
+
+// Node of the address ordered treap. max_size caches the largest extent in
+// the subtree so first-fit can skip whole subtrees that are too small.
+typedef struct FreeExtent {
+    uint32_t address;
+    uint32_t size;
+    uint32_t priority;
+    uint32_t max_size;
+    struct FreeExtent *left;
+    struct FreeExtent *right;
+} FreeExtent;
+
+// Free holes of one address space. Extents are kept in a treap keyed by
+// address (for first-fit and neighbour coalescing) plus a (size, address)
+// set (for best-fit / worst-fit), so allocate and release are O(log n).
+class FreeSpaceIndex {
+private:
+    FreeExtent *_root;
+    std::set<std::pair<uint32_t, uint32_t> > _by_size;
+    uint64_t _total_free;
+    uint32_t _seed;
+    uint32_t _histogram[FREE_HISTOGRAM_BUCKETS];
+
+    uint32_t nextPriority();
+    void update(FreeExtent *node);
+    void split(FreeExtent *node, uint32_t address, FreeExtent **left, FreeExtent **right);
+    FreeExtent* merge(FreeExtent *left, FreeExtent *right);
+    FreeExtent* detachFirst(FreeExtent **node);
+    FreeExtent* detachLast(FreeExtent **node);
+    FreeExtent* newExtent(uint32_t address, uint32_t size);
+    void deleteExtent(FreeExtent *node);
+    void destroy(FreeExtent *node);
+    FreeExtent* fitFrom(FreeExtent *node, uint32_t start, uint32_t size);
+    void collect(FreeExtent *node, std::vector<std::pair<uint32_t, uint32_t> >& result);
+
+public:
+    FreeSpaceIndex();
+    ~FreeSpaceIndex();
+
+    void release(uint32_t address, uint32_t size);
+    bool reserve(uint32_t address, uint32_t size);
+
+    bool firstFit(uint32_t size, uint32_t *address);
+    bool firstFitFrom(uint32_t start, uint32_t size, uint32_t *address);
+    bool bestFit(uint32_t size, uint32_t *address);
+    bool worstFit(uint32_t size, uint32_t *address);
+    bool findContaining(uint32_t address, uint32_t *start, uint32_t *size);
+
+    uint64_t getTotalFree();
+    uint32_t getLargest();
+    uint32_t getCount();
+    const uint32_t* getHistogram();
+    std::vector<std::pair<uint32_t, uint32_t> > getExtents();
+};
+
+#endif // __FREESPACE_H_
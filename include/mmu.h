@@ -4,54 +4,94 @@
 #include <iostream>
 #include <string>
 #include <vector>
-
-enum DataType : uint8_t {FreeSpace, Char, Short, Int, Float, Long, Double};
-
-typedef struct Variable {
-    std::string name;
-    DataType type;
-    uint32_t virtual_address;
-    uint32_t size;
-} Variable;
+#include <unordered_map>
+#include <string_view>
+#include "freespace.h"
+#include "allocpolicy.h"
+#include "datatype.h"
+#include "arena.h"
+#include "variabletable.h"
+#include "snapshot.h"
 
 typedef struct Process {
     uint32_t pid;
-    std::vector<Variable*> variables;
+    uint32_t slot; // position in the Mmu's process list
+    VariableTable variables; // names live in the arena
+    std::vector<uint32_t> page_users; // variables overlapping each virtual page
+    FreeSpaceIndex free_space;
+    AllocationPolicy *policy;
+    uint64_t live_requested_bytes;
+    uint64_t live_reserved_bytes;
+    uint64_t live_variable_bytes; // sizes of all variables, including <TEXT>, <GLOBALS> and <STACK>
+    uint64_t live_padding_bytes;
+    Arena arena;
+
+    Process(ChunkPool *chunks) : arena(chunks) {}
 } Process;
 
 class Mmu {
 private:
     uint32_t _next_pid;
     uint32_t _max_size;
+    uint32_t _page_size;
     std::vector<Process*> _processes;
+    std::unordered_map<uint32_t, Process*> _process_index;
+    AllocationPolicyType _policy_type;
+    AllocationStats _policy_stats;
+    uint64_t _live_variable_bytes;
+    uint64_t _live_padding_bytes;
+
+    // process metadata is pooled, so process churn reuses the same memory
+    ChunkPool _chunks;
+    ObjectPool<Process> _process_pool;
+
+    void destroyProcess(Process *proc);
+    void countPageUsers(Process *proc, uint32_t address, uint32_t size, int delta);
 
 public:
-    Mmu(int memory_size);
+    Mmu(int memory_size, int page_size, AllocationPolicyType policy);
     ~Mmu();
 
     uint32_t createProcess();
-    void addVariableToProcess(uint32_t pid, std::string var_name, DataType type, uint32_t size, uint32_t address);
-    void removeVariableFromProcess(uint32_t pid, uint32_t address);
+    uint32_t forkProcess(uint32_t pid);
+    bool addVariableToProcess(uint32_t pid, std::string var_name, DataType type, uint32_t size, uint32_t address, uint32_t padding, uint32_t reserved);
+    void removeVariableFromProcess(uint32_t pid, std::string_view var_name);
 
     void print();
+    static void print(const std::vector<Mmu*>& mmus);
 
     void removeProcess(uint32_t pid);
 
     uint32_t getAddress(uint32_t pid, std::string var_name);
     uint32_t getSize(uint32_t pid, std::string var_name);
 
-    uint32_t isEmptyPage(uint32_t pid, uint32_t from, uint32_t to);
+    bool isEmptyPage(uint32_t pid, uint32_t page);
 
-    uint32_t getFreeSpace(uint32_t pid, uint32_t size, u_int32_t allocatedSpace);
+    bool allocateSpace(uint32_t pid, uint32_t size, uint32_t slack, uint32_t *address, uint32_t *reserved);
+    void releaseSpace(uint32_t pid, uint32_t address, uint32_t reserved, uint32_t size);
     void modifyFreeSpace(u_int32_t pid, uint32_t size, uint32_t address, uint32_t offset);
-    void restoreFreeSpace(uint32_t pid, uint32_t address, uint32_t size);
+    void printPolicy();
+    static void printPolicy(const std::vector<Mmu*>& mmus);
+
+    Process* getProcess(uint32_t pid);
+    bool getVariable(uint32_t pid, const std::string& var_name, Variable *var);
 
     bool validProcess(uint32_t pid);
     bool validVar(uint32_t pid, std::string var_name);
     DataType returnDatatype(uint32_t pid, std::string var_name);
 
     std::vector<Process*> getProcesses();
-
+    uint32_t getNextPid();
+    uint32_t getMaxSize();
+    void setNextPid(uint32_t pid);
+    const AllocationStats& getPolicyStats();
+    uint64_t getLiveVariableBytes();
+    uint64_t getLivePaddingBytes();
+    AllocationPolicyType getPolicyType();
+
+    // processes, variables, heaps and policy state; load expects no processes
+    void save(SnapshotWriter& out);
+    bool load(SnapshotReader& in);
 };
 
 #endif // __MMU_H_
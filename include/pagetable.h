@@ -4,43 +4,249 @@
 #include <iostream>
 #include <string>
 #include <vector>
+#include <unordered_map>
 #include <map>
 #include <algorithm>
+#include <atomic>
+#include "frameallocator.h"
+#include "tlb.h"
+#include "replacement.h"
+#include "swap.h"
+#include "epoch.h"
+#include "snapshot.h"
 
-struct PageTableKeyComparator
+// Page table entry flag bits
+#define PTE_PRESENT  0x01
+#define PTE_DIRTY    0x02
+#define PTE_ACCESSED 0x04
+#define PTE_SWAPPED  0x08 // not resident, frame holds the swap slot
+#define PTE_LARGE    0x10 // part of a large page, pinned in memory
+#define PTE_COW      0x20 // frame shared by fork, copied on the first write
+#define PTE_SHARED   0x40 // frame of a shared segment, written in place
+#define PTE_ZERO     0x80 // reserved, gets a zero-filled frame on the first touch
+
+// Each process gets a three level radix tree indexed by page number (9 bits per level)
+#define PT_LEVEL_BITS 9
+#define PT_LEVEL_SIZE (1 << PT_LEVEL_BITS)
+#define PT_LEVEL_MASK (PT_LEVEL_SIZE - 1)
+#define PT_MAX_PAGES  (1 << (3 * PT_LEVEL_BITS))
+
+// A large page maps the pages of one whole leaf to a run of contiguous,
+// equally aligned frames (2 MB with 4 KB pages). Hardware would map it
+// with a single middle level entry; here the leaf keeps an entry per page,
+// flagged PTE_LARGE, so the reverse map and lock free readers work as is.
+#define PT_LARGE_PAGES PT_LEVEL_SIZE
+
+typedef struct PageTableEntry {
+    uint32_t frame;
+    uint32_t flags;
+} PageTableEntry;
+
+// Concurrent readers load entries and table pointers while the writer
+// changes them, so the writer stores them atomically. On x86 these are
+// plain stores.
+static inline void storeEntry(PageTableEntry *entry, uint32_t frame, uint32_t flags)
 {
-    inline bool operator() (const std::string& str1, const std::string& str2)
-    {
-        size_t sep1 = str1.find("|");
-        uint32_t pid1 = std::stoi(str1.substr(0, sep1));
-        int page1 = std::stoi(str1.substr(sep1 + 1));
-        size_t sep2 = str2.find("|");
-        uint32_t pid2 = std::stoi(str2.substr(0, sep2));
-        int page2 = std::stoi(str2.substr(sep2 + 1));
-
-        return (pid1 < pid2 || (pid1 == pid2 && page1 < page2));
-    }
-};
+    __atomic_store_n(&entry->frame, frame, __ATOMIC_RELAXED);
+    __atomic_store_n(&entry->flags, flags, __ATOMIC_RELEASE);
+}
+
+static inline void markEntry(PageTableEntry *entry, uint32_t flags)
+{
+    __atomic_store_n(&entry->flags, entry->flags | flags, __ATOMIC_RELAXED);
+}
+
+typedef struct PageTableLeaf {
+    PageTableEntry entries[PT_LEVEL_SIZE];
+    uint32_t used;
+} PageTableLeaf;
+
+typedef struct PageTableMiddle {
+    PageTableLeaf *leaves[PT_LEVEL_SIZE];
+    uint32_t used;
+} PageTableMiddle;
+
+// Reverse mapping from a resident frame to the page that occupies it
+typedef struct FrameOwner {
+    uint32_t pid;
+    uint32_t page;
+    PageTableEntry *entry;
+    int swap_slot; // copy of the page in swap, -1 if none
+} FrameOwner;
+
+typedef struct ProcessPageTable {
+    PageTableMiddle *middles[PT_LEVEL_SIZE];
+    uint32_t used;
+    uint32_t mapped;
+    uint32_t resident;
+    uint32_t large; // large pages mapped
+    uint32_t sequence; // seqlock over the entries, odd while the writer changes a mapping
+    std::map<uint32_t, uint32_t> ranges; // runs of mapped pages: first page -> one past the last
+} ProcessPageTable;
+
+typedef std::unordered_map<uint32_t, ProcessPageTable*> ProcessTableIndex;
+
+// Named memory that several processes map, backed by the same frames. A
+// segment lives as long as one of its pages is mapped somewhere.
+typedef struct SharedSegment {
+    std::string name;
+    uint32_t size;
+    std::vector<uint32_t> frames;
+    uint32_t live_frames;
+} SharedSegment;
 
 class PageTable {
 private:
     int _page_size;
-    std::map<std::string, int> _table;
+    std::unordered_map<uint32_t, ProcessPageTable*> _tables;
+    FrameAllocator *_frames;
+    Tlb *_tlb;
+
+    // Demand paging: with a replacement policy and swap space, a full memory
+    // evicts a resident page instead of failing
+    ReplacementPolicy *_replacement;
+    SwapSpace *_swap;
+    std::vector<FrameOwner> _owners;
+    std::vector<uint64_t> *_reference_log;
+    uint64_t _faults;
+    uint64_t _evictions;
+    uint64_t _writebacks;
+    uint64_t _mapped_pages;
+    uint64_t _swapped_pages;
+    bool _large_pages_enabled;
+    uint64_t _large_pages;
+    uint64_t _pinned_pages; // resident pages the replacement policy does not hold
+
+    // Lazy allocation: base pages are only reserved when they are mapped and
+    // get a frame on the first read or write
+    uint64_t _untouched_pages;
+    uint64_t _first_touch_faults;
+
+    // Copy-on-write: a frame shared by fork has no owner but a list of the
+    // pages mapping it, and stays pinned until only one of them is left
+    std::vector<uint32_t> _frame_refs; // mappings of each shared frame, 0 for a private one
+    std::unordered_map<uint32_t, std::vector<FrameOwner> > _sharers;
+    uint64_t _shared_frames;
+    uint64_t _frames_saved;
+    uint64_t _forks;
+    uint64_t _cow_faults;
+    std::unordered_map<std::string, SharedSegment*> _segments;
+    std::unordered_map<uint32_t, SharedSegment*> _segment_frames;
+    uint64_t _merge_passes;
+    uint64_t _merged_pages;
+
+    // Most recently used process table, saves the hash lookup for runs of the same pid
+    uint32_t _last_pid;
+    ProcessPageTable *_last_table;
+
+    // Concurrent readers: lock free lookups through a copy of _tables that is
+    // replaced whenever a process table comes or goes, while unlinked tables,
+    // nodes and frames wait in the epoch manager until no reader can hold them
+    EpochManager *_epochs;
+    std::atomic<ProcessTableIndex*> _published;
 
-    std::vector<std::string> sortedKeys();
+    ProcessPageTable* findTable(uint32_t pid);
+    void freeTable(ProcessPageTable *table);
+    static void deleteTable(ProcessPageTable *table);
+    void beginUpdate(ProcessPageTable *table);
+    void endUpdate(ProcessPageTable *table);
+    void publishTables();
+    bool walkConcurrent(uint32_t pid, uint32_t page, uint32_t *frame, ProcessPageTable **table, uint32_t *sequence);
+
+    // deletes an unlinked object right away, or once readers are done with it
+    template <typename T>
+    void retireObject(T *object)
+    {
+        if (_epochs != NULL)
+        {
+            _epochs->retire([object] { delete object; });
+        }
+        else
+        {
+            delete object;
+        }
+    }
+
+    PageTableEntry* findEntry(uint32_t pid, uint32_t page);
+    PageTableLeaf* createLeaf(uint32_t pid, uint32_t page, ProcessPageTable **table);
+    void demote(uint32_t pid, ProcessPageTable *table, uint32_t first_page);
+    bool isLargeFrame(uint32_t frame);
+    bool isSharedFrame(uint32_t frame);
+    bool copyOnWrite(uint32_t pid, uint32_t page, PageTableEntry *entry);
+    void dropSharer(uint32_t frame, PageTableEntry *entry);
+    void addSharer(uint32_t frame, uint32_t pid, uint32_t page, PageTableEntry *entry);
+    void shareFrame(uint32_t frame);
+    void freeFrame(uint32_t frame);
+    void mergeFrame(uint32_t frame, uint32_t target);
+    static PageTableEntry* walk(ProcessPageTable *table, uint32_t page);
+    static void addRange(ProcessPageTable *table, uint32_t page);
+    static void removeRange(ProcessPageTable *table, uint32_t page);
+    int obtainFrame();
+    void loadFrame(uint32_t pid, uint32_t page, PageTableEntry *entry, uint32_t frame, int swap_slot);
+    bool pageIn(uint32_t pid, uint32_t page, PageTableEntry *entry);
+    bool touchZeroPage(uint32_t pid, uint32_t page, PageTableEntry *entry);
+    void releaseEntry(PageTableEntry *entry);
+    void recordReference(uint32_t pid, uint32_t page);
+    void touchFrame(uint32_t pid, uint32_t page, uint32_t frame, bool pinned);
+    std::vector<uint32_t> sortedPids();
 
 public:
-    PageTable(int page_size);
+    PageTable(int page_size, FrameAllocator *frames, Tlb *tlb, ReplacementPolicy *replacement, SwapSpace *swap);
     ~PageTable();
 
-    void addEntry(uint32_t pid, int page_number);
+    bool addEntry(uint32_t pid, int page_number);
+    bool addLargeEntry(uint32_t pid, uint32_t first_page);
+    void enableLargePages();
+    bool largePagesEnabled();
+    bool forkProcess(uint32_t parent, uint32_t child);
+    bool findSegment(const std::string& name, uint32_t *size);
+    bool attachSegment(uint32_t pid, const std::string& name, uint32_t size, uint32_t first_page);
+    uint32_t mergePages();
     int getPhysicalAddress(uint32_t pid, uint32_t virtual_address);
+    int getPhysicalAddress(uint32_t pid, uint32_t virtual_address, bool write);
+    bool writeVirtual(uint32_t pid, uint32_t virtual_address, const void *data, uint32_t length);
+    bool readVirtual(uint32_t pid, uint32_t virtual_address, void *data, uint32_t length);
     void print();
+    static void print(const std::vector<PageTable*>& page_tables);
 
     int getNextPage(uint32_t pid);
+    uint32_t getFreePage(uint32_t pid, uint32_t from);
+    std::vector<std::pair<uint32_t, uint32_t> > getMappedRanges(uint32_t pid);
     int getPageSize();
+    ReplacementPolicyType getReplacementType();
     void printProcesses();
+    static void printProcesses(const std::vector<PageTable*>& page_tables);
+    void printPaging();
+    static void printPaging(const std::vector<PageTable*>& page_tables);
+    void printLargePages();
+    static void printLargePages(const std::vector<PageTable*>& page_tables);
+    void printSharing();
+    static void printSharing(const std::vector<PageTable*>& page_tables);
+    bool getProcessPages(uint32_t pid, uint32_t *mapped, uint32_t *resident);
+    uint64_t getMappedPages();
+    uint64_t getSwappedPages();
+    uint64_t getUntouchedPages();
+    uint64_t getFirstTouchFaults();
+    void setReferenceLog(std::vector<uint64_t> *log);
+
+    // Lock free translation for reader threads. Readers only see resident
+    // pages and leave the TLB, replacement policy and accessed bits alone;
+    // every mapping change still happens on the one writer thread.
+    void enableConcurrentReaders();
+    int registerReader();
+    bool translate(int reader, uint32_t pid, uint32_t virtual_address, uint32_t *physical_address);
+    bool readConcurrent(int reader, uint32_t pid, uint32_t virtual_address, void *data, uint32_t length);
+    EpochManager* getEpochs();
 
     void removeEntry(uint32_t pid, uint32_t page);
+    void removeProcess(uint32_t pid);
+    void removeAllProcesses();
+
+    // Mappings, shared frames and counters; frame contents are in the
+    // snapshot's memory image, pages in swap are stored inline. load expects
+    // no processes and the image already mapped; it keeps the saved eviction
+    // order if the replacement policy is the same, frame order otherwise.
+    bool save(SnapshotWriter& out);
+    bool load(SnapshotReader& in);
 };
 #endif // __PAGETABLE_H_
@@ -0,0 +1,139 @@
+#ifndef __REPLACEMENT_H_
+#define __REPLACEMENT_H_
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <set>
+#include <tuple>
+#include <cstdint>
+#include "snapshot.h"
+
+enum ReplacementPolicyType : uint8_t {ReplaceFifo, ReplaceLru, ReplaceClock, ReplaceLfu, ReplaceOpt};
+
+// Chooses which resident page to evict once every frame is in use. The page
+// table reports each page reference as exactly one frameLoaded (the page was
+// just brought into the frame) or frameAccessed (it was already resident).
+class ReplacementPolicy {
+public:
+    virtual ~ReplacementPolicy() {}
+
+    virtual ReplacementPolicyType getType() = 0;
+    virtual void frameLoaded(uint32_t frame) = 0;
+    virtual void frameAccessed(uint32_t frame) = 0;
+    virtual void frameReleased(uint32_t frame) = 0;
+
+    // only called while at least one frame is loaded
+    virtual uint32_t selectVictim() = 0;
+
+    // Eviction order of the loaded frames, for snapshots. load starts from
+    // an empty policy and fails unless it loads exactly the frames marked
+    // in loaded.
+    virtual void save(SnapshotWriter& out) = 0;
+    virtual bool load(SnapshotReader& in, const std::vector<uint8_t>& loaded) = 0;
+};
+
+// Loaded frames kept in a doubly linked list threaded through per frame
+// arrays, oldest at the head
+class FrameListPolicy : public ReplacementPolicy {
+protected:
+    std::vector<uint32_t> _prev;
+    std::vector<uint32_t> _next;
+    uint32_t _head;
+    uint32_t _tail;
+
+    void append(uint32_t frame);
+    void unlink(uint32_t frame);
+
+public:
+    FrameListPolicy(uint32_t num_frames);
+    void frameLoaded(uint32_t frame);
+    void frameReleased(uint32_t frame);
+    uint32_t selectVictim();
+    void save(SnapshotWriter& out);
+    bool load(SnapshotReader& in, const std::vector<uint8_t>& loaded);
+};
+
+class FifoPolicy : public FrameListPolicy {
+public:
+    FifoPolicy(uint32_t num_frames);
+    ReplacementPolicyType getType();
+    void frameAccessed(uint32_t frame);
+};
+
+class LruPolicy : public FrameListPolicy {
+public:
+    LruPolicy(uint32_t num_frames);
+    ReplacementPolicyType getType();
+    void frameAccessed(uint32_t frame);
+};
+
+// Second chance: the hand clears reference bits until it finds a loaded
+// frame that has not been referenced since the hand last passed it
+class ClockPolicy : public ReplacementPolicy {
+private:
+    std::vector<uint8_t> _loaded;
+    std::vector<uint8_t> _referenced;
+    uint32_t _hand;
+
+public:
+    ClockPolicy(uint32_t num_frames);
+    ReplacementPolicyType getType();
+    void frameLoaded(uint32_t frame);
+    void frameAccessed(uint32_t frame);
+    void frameReleased(uint32_t frame);
+    uint32_t selectVictim();
+    void save(SnapshotWriter& out);
+    bool load(SnapshotReader& in, const std::vector<uint8_t>& loaded);
+};
+
+// Least frequently used, ties broken by least recent use
+class LfuPolicy : public ReplacementPolicy {
+private:
+    typedef std::tuple<uint64_t, uint64_t, uint32_t> LfuKey; // count, last use, frame
+    std::vector<uint64_t> _counts;
+    std::vector<uint64_t> _last_used;
+    std::set<LfuKey> _order;
+    uint64_t _tick;
+
+public:
+    LfuPolicy(uint32_t num_frames);
+    ReplacementPolicyType getType();
+    void frameLoaded(uint32_t frame);
+    void frameAccessed(uint32_t frame);
+    void frameReleased(uint32_t frame);
+    uint32_t selectVictim();
+    void save(SnapshotWriter& out);
+    bool load(SnapshotReader& in, const std::vector<uint8_t>& loaded);
+};
+
+// Belady's optimal policy for offline traces. references holds every page
+// reference of the trace in order (pid << 32 | page), collected by an
+// earlier pass; the frame whose next use lies furthest ahead is evicted.
+// The reference string is the current run's, so frames restored from a
+// snapshot count as never used again until they are next referenced.
+class OptPolicy : public ReplacementPolicy {
+private:
+    std::vector<uint64_t> _next_use;
+    std::vector<uint64_t> _frame_next;
+    std::set<std::pair<uint64_t, uint32_t> > _order;
+    uint64_t _cursor;
+
+    void touch(uint32_t frame);
+
+public:
+    OptPolicy(uint32_t num_frames, const std::vector<uint64_t>& references);
+    ReplacementPolicyType getType();
+    void frameLoaded(uint32_t frame);
+    void frameAccessed(uint32_t frame);
+    void frameReleased(uint32_t frame);
+    uint32_t selectVictim();
+    void save(SnapshotWriter& out);
+    bool load(SnapshotReader& in, const std::vector<uint8_t>& loaded);
+};
+
+ReplacementPolicy* createReplacementPolicy(ReplacementPolicyType type, uint32_t num_frames, const std::vector<uint64_t>& references);
+ReplacementPolicyType stringToReplacementPolicy(std::string text, bool *valid);
+std::string replacementPolicyToString(ReplacementPolicyType type);
+
+#endif // __REPLACEMENT_H_
@@ -0,0 +1,83 @@
+#ifndef __SHARD_H_
+#define __SHARD_H_
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <cstdint>
+#include "binarytrace.h"
+#include "traceio.h"
+
+// One command on its way to a shard. Text commands keep a copy of their
+// line; binary records keep a copy of their values, since the reader reuses
+// its value buffer for the next record.
+typedef struct ShardTask {
+    uint64_t sequence;
+    uint32_t pid; // pid a create command hands out, 0 for every other command
+    bool binary;
+    std::string command;
+    TraceRecord record;
+    std::vector<uint8_t> values;
+    std::string output;
+    std::atomic<bool> done;
+} ShardTask;
+
+typedef void (*ShardExecutor)(ShardTask *task, uint32_t shard, std::ostream& out, void *context);
+
+// Runs commands on one worker thread per shard. Every shard owns a disjoint
+// set of pids, so commands of one pid run in trace order on a single thread
+// while different pids run side by side. Each command writes into its own
+// output buffer and the buffers are written to std::cout in trace order, so
+// the output reads as if the commands ran one after another.
+class ShardPool {
+private:
+    typedef struct ShardQueue {
+        std::mutex lock;
+        std::condition_variable ready;
+        std::vector<ShardTask*> tasks;   // published to the worker
+        std::vector<ShardTask*> pending; // submitted, published in batches
+        std::thread worker;
+    } ShardQueue;
+
+    uint32_t _num_shards;
+    ShardExecutor _executor;
+    void *_context;
+    std::vector<ShardQueue*> _queues;
+    std::atomic<bool> _stopping;
+
+    // ring of commands in flight, indexed by sequence number
+    std::vector<ShardTask*> _window;
+    uint64_t _next_sequence;
+    uint64_t _next_output;
+
+    // workers only signal the finished command the dispatcher waits for
+    std::atomic<uint64_t> _awaited;
+    std::mutex _done_lock;
+    std::condition_variable _done;
+
+    void work(uint32_t shard);
+    void publish(uint32_t shard);
+    void publishAll();
+    void writeFinished();
+    void waitFor(uint64_t sequence);
+
+public:
+    ShardPool(uint32_t num_shards, uint32_t window_size, ShardExecutor executor, void *context);
+    ~ShardPool();
+
+    uint32_t getNumShards();
+    uint32_t shardOf(uint32_t pid);
+
+    // slot for the next command in trace order, must be submitted before the next call
+    ShardTask* nextTask();
+    void submit(ShardTask *task, uint32_t shard);
+
+    // waits until every submitted command ran and its output was written
+    void drain();
+};
+
+#endif // __SHARD_H_
@@ -0,0 +1,80 @@
+#ifndef __SNAPSHOT_H_
+#define __SNAPSHOT_H_
+
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include "datatype.h"
+
+class Mmu;
+class PageTable;
+class FrameAllocator;
+
+// Snapshot layout (version 2):
+//   header:   "MSNP" <u8 version> <3 reserved bytes> <u64 image offset>
+//   metadata: <page_size> <num_frames> <u8 allocation policy>, then the MMU
+//             and the page table. Integers are LEB128 varints, names are
+//             <len> <bytes>, pages swapped out are stored inline. The
+//             replacement policy state is <u8 policy> <len> <bytes>, so a
+//             run with another policy can skip it.
+//   image:    physical memory at the image offset, aligned for mmap. Frames
+//             not in use are holes, so the file only takes the frames in use.
+#define SNAPSHOT_MAGIC       "MSNP"
+#define SNAPSHOT_VERSION     2
+#define SNAPSHOT_HEADER_SIZE 16
+#define SNAPSHOT_IMAGE_ALIGN 65536
+
+class SnapshotWriter {
+private:
+    std::vector<uint8_t> _buffer;
+
+public:
+    void putByte(uint8_t value);
+    void putVarint(uint64_t value);
+    void putBytes(const void *data, size_t length);
+    void putName(std::string_view name);
+    const std::vector<uint8_t>& getData();
+
+    // writes header, metadata and the memory image of frames to path
+    bool write(std::string path, FrameAllocator *frames);
+};
+
+// Reads the metadata of a snapshot from an mmap of the file. The getters
+// fail rather than read past the end of a truncated or corrupt file.
+class SnapshotReader {
+private:
+    int _fd;
+    const uint8_t *_data;
+    size_t _length;
+    size_t _position;
+    uint64_t _image_offset;
+
+public:
+    SnapshotReader();
+    ~SnapshotReader();
+
+    bool open(std::string path);
+    bool getByte(uint8_t *value);
+    bool getVarint(uint64_t *value);
+    bool getVarint32(uint32_t *value);
+    bool getBytes(size_t length, const uint8_t **data);
+    bool getName(std::string_view *name);
+    size_t getPosition();
+
+    // whether the file holds a whole memory image of memory_size bytes
+    bool hasImage(uint64_t memory_size);
+    // maps the memory image over frames, its pages are read in as they are touched
+    bool mapImage(FrameAllocator *frames);
+};
+
+bool saveSnapshot(std::string path, Mmu *mmu, PageTable *page_table, FrameAllocator *frames);
+bool restoreSnapshot(std::string path, Mmu *mmu, PageTable *page_table, FrameAllocator *frames);
+
+// Next pid and variable types by pid and name, for a trace recorder that
+// follows the processes of a trace without running it
+bool readSnapshotTypes(std::string path, uint32_t *next_pid, std::unordered_map<uint32_t, std::unordered_map<std::string, DataType> >& types);
+
+#endif // __SNAPSHOT_H_
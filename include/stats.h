@@ -0,0 +1,70 @@
+#ifndef __STATS_H_
+#define __STATS_H_
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include "mmu.h"
+#include "pagetable.h"
+#include "frameallocator.h"
+
+enum StatsFormat : uint8_t {StatsCsv, StatsJson};
+
+// Point in time view of memory use. Everything is assembled from counters
+// the Mmu, free space indexes and page table keep up to date as they change,
+// so taking a snapshot costs O(processes), not a walk over every variable,
+// hole or page.
+typedef struct MemorySnapshot {
+    uint64_t command;
+    uint32_t frames_total;
+    uint32_t frames_used;
+    uint64_t mapped_pages;
+    uint64_t swapped_pages;
+    uint64_t untouched_pages;   // mapped but never read or written, so without a frame
+    uint64_t resident_pages;
+    uint64_t first_touch_faults;
+    uint64_t mapped_bytes;
+    uint64_t variable_bytes;
+    uint64_t padding_bytes;
+    uint64_t rounding_bytes;  // size class / buddy round up inside reserved blocks
+    uint64_t unused_bytes;    // mapped but holding no variable (page rounding)
+    uint64_t free_bytes;
+    uint64_t largest_hole;
+    uint64_t holes;
+    uint64_t histogram[FREE_HISTOGRAM_BUCKETS];
+    double frame_utilization;
+    double external_fragmentation;
+    double internal_fragmentation;
+    double page_rounding;
+} MemorySnapshot;
+
+// A sharded simulator hands in the Mmu and page table of every shard, index
+// for index, and gets one snapshot over all of them.
+class StatsEngine {
+private:
+    std::vector<Mmu*> _mmus;
+    std::vector<PageTable*> _page_tables;
+    FrameAllocator *_frames;
+
+    FILE *_series;
+    StatsFormat _format;
+    uint64_t _samples;
+
+public:
+    StatsEngine(Mmu *mmu, PageTable *page_table, FrameAllocator *frames);
+    StatsEngine(const std::vector<Mmu*>& mmus, const std::vector<PageTable*>& page_tables, FrameAllocator *frames);
+    ~StatsEngine();
+
+    void collect(uint64_t command, MemorySnapshot *snapshot);
+    void print();
+
+    // Time series of snapshots: JSON when path ends in ".json", CSV otherwise
+    bool openSeries(std::string path);
+    bool isRecording();
+    void sample(uint64_t command);
+    void closeSeries();
+};
+
+#endif // __STATS_H_
@@ -0,0 +1,16 @@
+#ifndef __STRESS_H_
+#define __STRESS_H_
+
+#include <cstdint>
+
+// writer operations of a --stress-translate run
+#define STRESS_OPERATIONS 50000
+
+// Runs reader threads through the lock free translation path while one
+// writer keeps creating and tearing down mappings. Every mapped page holds
+// a signature of its pid and page number, so a reader that reaches a torn,
+// stale or freed mapping reads the wrong signature (freed frames are
+// poisoned). Prints a summary and returns false if any reader saw one.
+bool runTranslationStress(int page_size, uint32_t num_readers, uint64_t operations);
+
+#endif // __STRESS_H_
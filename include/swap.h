@@ -0,0 +1,35 @@
+#ifndef __SWAP_H_
+#define __SWAP_H_
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Backing store for evicted pages: a file on local disk divided into page
+// sized slots. Freed slots are reused before the file is grown.
+class SwapSpace {
+private:
+    int _fd;
+    uint32_t _slot_size;
+    uint32_t _num_slots;
+    std::vector<uint32_t> _free_slots;
+    uint64_t _reads;
+    uint64_t _writes;
+
+public:
+    SwapSpace(std::string path, uint32_t slot_size);
+    ~SwapSpace();
+
+    bool isOpen();
+    int allocate();
+    void release(uint32_t slot);
+    bool write(uint32_t slot, const void *data);
+    bool read(uint32_t slot, void *data);
+
+    uint32_t getUsedSlots();
+    uint64_t getReads();
+    uint64_t getWrites();
+};
+
+#endif // __SWAP_H_
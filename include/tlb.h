@@ -0,0 +1,66 @@
+#ifndef __TLB_H_
+#define __TLB_H_
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+enum TlbPolicy : uint8_t {TlbLru, TlbClock};
+
+typedef struct TlbEntry {
+    bool valid;
+    bool referenced;
+    uint32_t pid;
+    uint32_t page;  // first page of a large page
+    uint32_t frame; // first frame of a large page
+    uint32_t pages; // 1, or the pages of a large page
+    uint64_t last_used;
+} TlbEntry;
+
+// Set associative translation cache tagged by pid (acting as the ASID), so
+// entries of different processes can live side by side without flushing on
+// every switch between them. Entries of large pages sit in the set of
+// their first page and cover all of its pages.
+class Tlb {
+private:
+    uint32_t _num_sets;
+    uint32_t _ways;
+    TlbPolicy _policy;
+    std::vector<TlbEntry> _entries;
+    std::vector<uint32_t> _clock_hands;
+    uint64_t _tick;
+    uint32_t _large_pages; // pages per large page, 0 until one is inserted
+
+    uint64_t _hits;
+    uint64_t _misses;
+    uint64_t _shootdowns;
+
+    uint32_t setIndex(uint32_t pid, uint32_t page);
+    uint32_t chooseVictim(uint32_t set);
+    TlbEntry* find(uint32_t pid, uint32_t first_page, uint32_t page);
+    void fill(uint32_t pid, uint32_t page, uint32_t frame, uint32_t pages);
+
+public:
+    Tlb(uint32_t num_entries, uint32_t ways, TlbPolicy policy);
+    ~Tlb();
+
+    bool lookup(uint32_t pid, uint32_t page, uint32_t *frame);
+    void insert(uint32_t pid, uint32_t page, uint32_t frame);
+    void insertLarge(uint32_t pid, uint32_t first_page, uint32_t first_frame, uint32_t pages);
+    void invalidate(uint32_t pid, uint32_t page);
+    void flush(uint32_t pid);
+
+    uint32_t getNumEntries();
+    uint64_t getHits();
+    uint64_t getMisses();
+    uint64_t getShootdowns();
+    double getHitRate();
+
+    void print(int page_size);
+    static void print(const std::vector<Tlb*>& tlbs, int page_size);
+};
+
+TlbPolicy stringToTlbPolicy(std::string text, bool *valid);
+
+#endif // __TLB_H_
@@ -0,0 +1,62 @@
+#ifndef __TRACEIO_H_
+#define __TRACEIO_H_
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdio>
+
+// Reads a command trace in large blocks and hands it out one line at a time
+class LineReader {
+private:
+    int _fd;
+    bool _owns_fd;
+    bool _eof;
+    std::vector<char> _buffer;
+    size_t _start;
+    size_t _end;
+
+    bool fill();
+
+public:
+    LineReader(int fd, bool owns_fd, size_t block_size);
+    ~LineReader();
+
+    bool nextLine(std::string& line);
+};
+
+// std::cout replacement for batch mode: writes straight into the fully
+// buffered stdout FILE so printf and << output keep their order, and ignores
+// the flush requested by every std::endl. Flushing is left to the caller.
+class StdioOutput : public std::streambuf {
+protected:
+    int overflow(int c);
+    std::streamsize xsputn(const char *s, std::streamsize n);
+    int sync();
+};
+
+// Discards everything written to it
+class NullOutput : public std::streambuf {
+protected:
+    int overflow(int c);
+    std::streamsize xsputn(const char *s, std::streamsize n);
+};
+
+// Appends everything written to it to a caller supplied string, so the
+// output of one command can be held back and written out later
+class StringOutput : public std::streambuf {
+private:
+    std::string *_target;
+
+protected:
+    int overflow(int c);
+    std::streamsize xsputn(const char *s, std::streamsize n);
+
+public:
+    StringOutput();
+    void setTarget(std::string *target);
+};
+
+LineReader* openTrace(std::string path);
+
+#endif // __TRACEIO_H_
@@ -0,0 +1,62 @@
+#ifndef __VARIABLETABLE_H_
+#define __VARIABLETABLE_H_
+
+#include <iostream>
+#include <vector>
+#include <string_view>
+#include <unordered_map>
+#include <cstdint>
+#include "datatype.h"
+
+// name ID of a removed row
+#define VARIABLE_REMOVED UINT32_MAX
+
+// One row of a VariableTable, copied out of its columns
+typedef struct Variable {
+    std::string_view name;
+    DataType type;
+    uint32_t virtual_address;
+    uint32_t size;
+    uint32_t padding;
+    uint32_t reserved;
+} Variable;
+
+// Variables of one process, stored column-wise. Rows stay in creation
+// order for printing and are found by name through a name ID. Removing a
+// variable only marks its row; the columns are compacted once removed rows
+// outnumber live ones, so a removal costs O(1) amortized. Names are not
+// copied: the caller keeps them alive until the row is removed.
+class VariableTable {
+private:
+    // rows in creation order
+    std::vector<uint32_t> _addresses;
+    std::vector<uint32_t> _sizes;
+    std::vector<DataType> _types;
+    std::vector<uint32_t> _name_ids;
+    std::vector<uint32_t> _paddings;
+    std::vector<uint32_t> _reserved;
+
+    // name ID -> name and row, IDs of removed rows are reused
+    std::vector<std::string_view> _names;
+    std::vector<uint32_t> _rows;
+    std::vector<uint32_t> _free_ids;
+    std::unordered_map<std::string_view, uint32_t> _name_index;
+
+    uint32_t _removed_rows;
+
+    void compact();
+
+public:
+    VariableTable();
+    ~VariableTable();
+
+    void add(std::string_view name, DataType type, uint32_t address, uint32_t size, uint32_t padding, uint32_t reserved);
+    bool find(std::string_view name, Variable *var);
+    bool remove(std::string_view name, Variable *removed);
+
+    // rows including removed ones, getRow() is false for those
+    uint32_t getRowCount();
+    bool getRow(uint32_t row, Variable *var);
+};
+
+#endif // __VARIABLETABLE_H_
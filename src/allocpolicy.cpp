@@ -0,0 +1,478 @@
+#include "allocpolicy.h"
+
+#define SEGREGATED_MIN_SHIFT 3
+#define SEGREGATED_MAX_SHIFT 16
+#define BUDDY_MIN_ORDER      4
+#define BUDDY_MAX_ALIGN      65536
+
+bool FirstFitPolicy::allocate(FreeSpaceIndex *free_space, uint32_t size, uint32_t *address, uint32_t *reserved)
+{
+    if (!free_space->firstFit(size, address))
+    {
+        return false;
+    }
+    free_space->reserve(*address, size);
+    *reserved = size;
+    return true;
+}
+
+void FirstFitPolicy::release(FreeSpaceIndex *free_space, uint32_t address, uint32_t reserved)
+{
+    free_space->release(address, reserved);
+}
+
+AllocationPolicy* FirstFitPolicy::clone()
+{
+    return new FirstFitPolicy(*this);
+}
+
+NextFitPolicy::NextFitPolicy()
+{
+    _rover = 0;
+}
+
+bool NextFitPolicy::allocate(FreeSpaceIndex *free_space, uint32_t size, uint32_t *address, uint32_t *reserved)
+{
+    uint32_t start, length;
+
+    //continue inside the hole the last allocation ended in, then search onwards and wrap around
+    if (free_space->findContaining(_rover, &start, &length) && start + length - _rover >= size)
+    {
+        *address = _rover;
+    }
+    else if (!free_space->firstFitFrom(_rover, size, address) && !free_space->firstFit(size, address))
+    {
+        return false;
+    }
+
+    free_space->reserve(*address, size);
+    *reserved = size;
+    _rover = *address + size;
+    return true;
+}
+
+void NextFitPolicy::release(FreeSpaceIndex *free_space, uint32_t address, uint32_t reserved)
+{
+    free_space->release(address, reserved);
+}
+
+AllocationPolicy* NextFitPolicy::clone()
+{
+    return new NextFitPolicy(*this);
+}
+
+void NextFitPolicy::save(SnapshotWriter& out)
+{
+    out.putVarint(_rover);
+}
+
+bool NextFitPolicy::load(SnapshotReader& in)
+{
+    return in.getVarint32(&_rover);
+}
+
+bool BestFitPolicy::allocate(FreeSpaceIndex *free_space, uint32_t size, uint32_t *address, uint32_t *reserved)
+{
+    if (!free_space->bestFit(size, address))
+    {
+        return false;
+    }
+    free_space->reserve(*address, size);
+    *reserved = size;
+    return true;
+}
+
+void BestFitPolicy::release(FreeSpaceIndex *free_space, uint32_t address, uint32_t reserved)
+{
+    free_space->release(address, reserved);
+}
+
+AllocationPolicy* BestFitPolicy::clone()
+{
+    return new BestFitPolicy(*this);
+}
+
+bool WorstFitPolicy::allocate(FreeSpaceIndex *free_space, uint32_t size, uint32_t *address, uint32_t *reserved)
+{
+    if (!free_space->worstFit(size, address))
+    {
+        return false;
+    }
+    free_space->reserve(*address, size);
+    *reserved = size;
+    return true;
+}
+
+void WorstFitPolicy::release(FreeSpaceIndex *free_space, uint32_t address, uint32_t reserved)
+{
+    free_space->release(address, reserved);
+}
+
+AllocationPolicy* WorstFitPolicy::clone()
+{
+    return new WorstFitPolicy(*this);
+}
+
+SegregatedFitPolicy::SegregatedFitPolicy()
+{
+    _classes.resize(SEGREGATED_MAX_SHIFT - SEGREGATED_MIN_SHIFT + 1);
+    _held_bytes = 0;
+}
+
+int SegregatedFitPolicy::sizeClass(uint32_t size)
+{
+    int shift = SEGREGATED_MIN_SHIFT;
+    while (shift <= SEGREGATED_MAX_SHIFT && (1u << shift) < size)
+    {
+        shift++;
+    }
+    return (shift > SEGREGATED_MAX_SHIFT) ? -1 : shift - SEGREGATED_MIN_SHIFT;
+}
+
+bool SegregatedFitPolicy::allocate(FreeSpaceIndex *free_space, uint32_t size, uint32_t *address, uint32_t *reserved)
+{
+    int size_class = sizeClass(size);
+
+    //too large for any class, place it exactly
+    if (size_class < 0)
+    {
+        if (!free_space->firstFit(size, address))
+        {
+            return false;
+        }
+        free_space->reserve(*address, size);
+        *reserved = size;
+        return true;
+    }
+
+    uint32_t block_size = 1u << (size_class + SEGREGATED_MIN_SHIFT);
+    std::vector<uint32_t> &blocks = _classes[size_class];
+    if (!blocks.empty())
+    {
+        *address = blocks.back();
+        blocks.pop_back();
+        _held_bytes -= block_size;
+    }
+    else
+    {
+        if (!free_space->firstFit(block_size, address))
+        {
+            return false;
+        }
+        free_space->reserve(*address, block_size);
+    }
+
+    *reserved = block_size;
+    return true;
+}
+
+void SegregatedFitPolicy::release(FreeSpaceIndex *free_space, uint32_t address, uint32_t reserved)
+{
+    int size_class = sizeClass(reserved);
+    if (size_class < 0 || (1u << (size_class + SEGREGATED_MIN_SHIFT)) != reserved)
+    {
+        free_space->release(address, reserved);
+        return;
+    }
+
+    _classes[size_class].push_back(address);
+    _held_bytes += reserved;
+}
+
+AllocationPolicy* SegregatedFitPolicy::clone()
+{
+    return new SegregatedFitPolicy(*this);
+}
+
+uint64_t SegregatedFitPolicy::getHeldBytes()
+{
+    return _held_bytes;
+}
+
+void SegregatedFitPolicy::save(SnapshotWriter& out)
+{
+    int i, j;
+    for (i = 0; i < _classes.size(); i++)
+    {
+        out.putVarint(_classes[i].size());
+        for (j = 0; j < _classes[i].size(); j++)
+        {
+            out.putVarint(_classes[i][j]);
+        }
+    }
+}
+
+//held bytes follow from the blocks on the class lists
+bool SegregatedFitPolicy::load(SnapshotReader& in)
+{
+    uint32_t i, j, count, address;
+    _held_bytes = 0;
+    for (i = 0; i < _classes.size(); i++)
+    {
+        if (!in.getVarint32(&count))
+        {
+            return false;
+        }
+        _classes[i].clear();
+        for (j = 0; j < count; j++)
+        {
+            if (!in.getVarint32(&address))
+            {
+                return false;
+            }
+            _classes[i].push_back(address);
+        }
+        _held_bytes += (uint64_t)count << (i + SEGREGATED_MIN_SHIFT);
+    }
+    return true;
+}
+
+BuddyPolicy::BuddyPolicy()
+{
+    _initialized = false;
+    _base = 0;
+    _max_order = -1;
+    _held_bytes = 0;
+}
+
+bool BuddyPolicy::initialize(FreeSpaceIndex *free_space)
+{
+    uint32_t start, length;
+    if (!free_space->worstFit(1, &start) || !free_space->findContaining(start, &start, &length))
+    {
+        return false;
+    }
+
+    //largest power of two block that fits in the largest hole once its start is aligned
+    int order = 31;
+    while (order >= BUDDY_MIN_ORDER)
+    {
+        uint64_t block = 1ULL << order;
+        uint64_t align = block < BUDDY_MAX_ALIGN ? block : BUDDY_MAX_ALIGN;
+        uint64_t base = ((uint64_t)start + align - 1) / align * align;
+        if (base + block <= (uint64_t)start + length)
+        {
+            _base = base;
+            break;
+        }
+        order--;
+    }
+    if (order < BUDDY_MIN_ORDER)
+    {
+        return false;
+    }
+
+    free_space->reserve(_base, 1u << order);
+    _max_order = order;
+    _free_blocks.resize(order + 1);
+    _free_blocks[order].insert(0);
+    _held_bytes = 1ULL << order;
+    _initialized = true;
+    return true;
+}
+
+int BuddyPolicy::blockOrder(uint32_t size)
+{
+    int order = BUDDY_MIN_ORDER;
+    while (order < 32 && (1ULL << order) < size)
+    {
+        order++;
+    }
+    return order;
+}
+
+bool BuddyPolicy::allocate(FreeSpaceIndex *free_space, uint32_t size, uint32_t *address, uint32_t *reserved)
+{
+    if (!_initialized && !initialize(free_space))
+    {
+        return false;
+    }
+
+    int order = blockOrder(size);
+    int j = order;
+    while (j <= _max_order && _free_blocks[j].empty())
+    {
+        j++;
+    }
+    if (j > _max_order)
+    {
+        return false;
+    }
+
+    uint32_t offset = *_free_blocks[j].begin();
+    _free_blocks[j].erase(_free_blocks[j].begin());
+
+    //split down to the requested order, keeping the upper halves free
+    while (j > order)
+    {
+        j--;
+        _free_blocks[j].insert(offset + (1u << j));
+    }
+
+    *address = _base + offset;
+    *reserved = 1u << order;
+    _held_bytes -= *reserved;
+    return true;
+}
+
+void BuddyPolicy::release(FreeSpaceIndex *free_space, uint32_t address, uint32_t reserved)
+{
+    uint32_t offset = address - _base;
+    int order = blockOrder(reserved);
+    _held_bytes += reserved;
+
+    //merge with the buddy for as long as it is free too
+    while (order < _max_order)
+    {
+        uint32_t buddy = offset ^ (1u << order);
+        std::set<uint32_t>::iterator it = _free_blocks[order].find(buddy);
+        if (it == _free_blocks[order].end())
+        {
+            break;
+        }
+        _free_blocks[order].erase(it);
+        offset = offset < buddy ? offset : buddy;
+        order++;
+    }
+    _free_blocks[order].insert(offset);
+}
+
+AllocationPolicy* BuddyPolicy::clone()
+{
+    return new BuddyPolicy(*this);
+}
+
+uint64_t BuddyPolicy::getHeldBytes()
+{
+    return _held_bytes;
+}
+
+void BuddyPolicy::save(SnapshotWriter& out)
+{
+    int i;
+    out.putByte(_initialized ? 1 : 0);
+    if (!_initialized)
+    {
+        return;
+    }
+    out.putVarint(_base);
+    out.putVarint(_max_order);
+    for (i = 0; i <= _max_order; i++)
+    {
+        out.putVarint(_free_blocks[i].size());
+        for (std::set<uint32_t>::iterator it = _free_blocks[i].begin(); it != _free_blocks[i].end(); it++)
+        {
+            out.putVarint(*it);
+        }
+    }
+}
+
+bool BuddyPolicy::load(SnapshotReader& in)
+{
+    uint8_t initialized;
+    uint32_t max_order, count, offset;
+    int i;
+    if (!in.getByte(&initialized))
+    {
+        return false;
+    }
+    if (initialized == 0)
+    {
+        return true;
+    }
+    if (!in.getVarint32(&_base) || !in.getVarint32(&max_order) || max_order < BUDDY_MIN_ORDER || max_order > 31)
+    {
+        return false;
+    }
+
+    _max_order = max_order;
+    _free_blocks.assign(_max_order + 1, std::set<uint32_t>());
+    _held_bytes = 0;
+    for (i = 0; i <= _max_order; i++)
+    {
+        if (!in.getVarint32(&count))
+        {
+            return false;
+        }
+        while (count-- > 0)
+        {
+            if (!in.getVarint32(&offset))
+            {
+                return false;
+            }
+            _free_blocks[i].insert(offset);
+            _held_bytes += 1ULL << i;
+        }
+    }
+    _initialized = true;
+    return true;
+}
+
+AllocationPolicy* createAllocationPolicy(AllocationPolicyType type)
+{
+    switch (type)
+    {
+        case NextFit:
+            return new NextFitPolicy();
+        case BestFit:
+            return new BestFitPolicy();
+        case WorstFit:
+            return new WorstFitPolicy();
+        case SegregatedFit:
+            return new SegregatedFitPolicy();
+        case BuddyFit:
+            return new BuddyPolicy();
+        default:
+            return new FirstFitPolicy();
+    }
+}
+
+AllocationPolicyType stringToAllocationPolicy(std::string text, bool *valid)
+{
+    *valid = true;
+    if (text == "first")
+    {
+        return FirstFit;
+    }
+    if (text == "next")
+    {
+        return NextFit;
+    }
+    if (text == "best")
+    {
+        return BestFit;
+    }
+    if (text == "worst")
+    {
+        return WorstFit;
+    }
+    if (text == "segregated")
+    {
+        return SegregatedFit;
+    }
+    if (text == "buddy")
+    {
+        return BuddyFit;
+    }
+    *valid = false;
+    return FirstFit;
+}
+
+std::string allocationPolicyToString(AllocationPolicyType type)
+{
+    switch (type)
+    {
+        case NextFit:
+            return "next-fit";
+        case BestFit:
+            return "best-fit";
+        case WorstFit:
+            return "worst-fit";
+        case SegregatedFit:
+            return "segregated";
+        case BuddyFit:
+            return "buddy";
+        default:
+            return "first-fit";
+    }
+}
@@ -0,0 +1,174 @@
+#include <cstring>
+#include "arena.h"
+
+ChunkPool::ChunkPool()
+{
+    _free = NULL;
+    _num_chunks = 0;
+    _free_chunks = 0;
+}
+
+ChunkPool::~ChunkPool()
+{
+    while (_free != NULL)
+    {
+        ArenaChunk *chunk = _free;
+        _free = chunk->next;
+        delete chunk;
+    }
+}
+
+ArenaChunk* ChunkPool::allocate()
+{
+    if (_free == NULL)
+    {
+        _num_chunks++;
+        return new ArenaChunk();
+    }
+
+    ArenaChunk *chunk = _free;
+    _free = chunk->next;
+    _free_chunks--;
+    return chunk;
+}
+
+//takes back a linked list of count chunks in one step
+void ChunkPool::release(ArenaChunk *first, ArenaChunk *last, uint64_t count)
+{
+    last->next = _free;
+    _free = first;
+    _free_chunks += count;
+}
+
+uint64_t ChunkPool::getNumChunks()
+{
+    return _num_chunks;
+}
+
+uint64_t ChunkPool::getFreeChunks()
+{
+    return _free_chunks;
+}
+
+Arena::Arena(ChunkPool *pool)
+{
+    _pool = pool;
+    _first = NULL;
+    _last = NULL;
+    _num_chunks = 0;
+    _next = NULL;
+    _remaining = 0;
+    memset(_free, 0, sizeof(_free));
+}
+
+Arena::~Arena()
+{
+    releaseAll();
+}
+
+void *Arena::allocate(uint32_t size)
+{
+    size = (size + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+    if (size == 0)
+    {
+        size = ARENA_ALIGNMENT;
+    }
+    if (size > ARENA_CHUNK_SIZE)
+    {
+        void *block = ::operator new(size);
+        _large.push_back(block);
+        return block;
+    }
+
+    //reuse a released block of the same class first
+    uint32_t size_class = size / ARENA_ALIGNMENT - 1;
+    if (_free[size_class] != NULL)
+    {
+        FreeBlock *block = _free[size_class];
+        _free[size_class] = block->next;
+        return block;
+    }
+
+    //the tail of a full chunk is left unused
+    if (_remaining < size)
+    {
+        ArenaChunk *chunk = _pool->allocate();
+        chunk->next = _first;
+        _first = chunk;
+        if (_last == NULL)
+        {
+            _last = chunk;
+        }
+        _num_chunks++;
+        _next = chunk->data;
+        _remaining = ARENA_CHUNK_SIZE;
+    }
+
+    void *block = _next;
+    _next += size;
+    _remaining -= size;
+    return block;
+}
+
+void Arena::release(void *block, uint32_t size)
+{
+    size = (size + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+    if (size == 0)
+    {
+        size = ARENA_ALIGNMENT;
+    }
+    if (size > ARENA_CHUNK_SIZE)
+    {
+        size_t i;
+        for (i = 0; i < _large.size(); i++)
+        {
+            if (_large[i] == block)
+            {
+                _large[i] = _large.back();
+                _large.pop_back();
+                break;
+            }
+        }
+        ::operator delete(block);
+        return;
+    }
+
+    FreeBlock *free_block = (FreeBlock*)block;
+    uint32_t size_class = size / ARENA_ALIGNMENT - 1;
+    free_block->next = _free[size_class];
+    _free[size_class] = free_block;
+}
+
+//O(1) apart from blocks larger than a chunk, which only very long names need
+void Arena::releaseAll()
+{
+    size_t i;
+    for (i = 0; i < _large.size(); i++)
+    {
+        ::operator delete(_large[i]);
+    }
+    _large.clear();
+
+    if (_first != NULL)
+    {
+        _pool->release(_first, _last, _num_chunks);
+    }
+    _first = NULL;
+    _last = NULL;
+    _num_chunks = 0;
+    _next = NULL;
+    _remaining = 0;
+    memset(_free, 0, sizeof(_free));
+}
+
+std::string_view Arena::intern(std::string_view name)
+{
+    char *copy = (char*)allocate(name.size());
+    memcpy(copy, name.data(), name.size());
+    return std::string_view(copy, name.size());
+}
+
+void Arena::releaseName(std::string_view name)
+{
+    release((void*)name.data(), name.size());
+}
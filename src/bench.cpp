@@ -0,0 +1,110 @@
+#include <cstdio>
+#include <string>
+#include <map>
+#include <vector>
+#include <random>
+#include <chrono>
+#include "bench.h"
+#include "pagetable.h"
+
+// processes and pages per process the translations are spread over
+#define BENCH_PROCESSES 16
+#define BENCH_PAGES 1024
+
+// addresses are picked up front, so the timed loop doesn't pay for the random numbers (power of two)
+#define BENCH_ADDRESSES 65536
+
+typedef struct BenchAddress {
+    uint32_t pid;
+    uint32_t virtual_address;
+} BenchAddress;
+
+// keeps the compiler from dropping translations whose result is never used
+static volatile uint64_t bench_sink;
+
+// lookup of the page table as it was before the radix tree
+static int stringKeyedLookup(std::map<std::string, int>& table, int page_size, uint32_t pid, uint32_t virtual_address)
+{
+    int page_number = virtual_address / page_size;
+    int page_offset = virtual_address % page_size;
+    std::string entry = std::to_string(pid) + "|" + std::to_string(page_number);
+    std::map<std::string, int>::iterator it = table.find(entry);
+    return it == table.end() ? -1 : it->second * page_size + page_offset;
+}
+
+template <typename Translate>
+static bool timeTranslations(const char *table_name, const char *pattern, const std::vector<BenchAddress>& addresses,
+                             uint64_t translations, Translate translate)
+{
+    uint64_t i;
+    uint64_t checksum = 0;
+    bool failed = false;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (i = 0; i < translations; i++)
+    {
+        const BenchAddress& address = addresses[i & (BENCH_ADDRESSES - 1)];
+        int physical = translate(address.pid, address.virtual_address);
+        failed = failed || physical < 0;
+        checksum += physical;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    bench_sink = checksum;
+
+    printf(" %-12s | %-10s | %9.3f | %16.0f\n", table_name, pattern, seconds, seconds > 0 ? translations / seconds : 0.0);
+    fflush(stdout);
+    return !failed;
+}
+
+bool runTranslationBenchmark(int page_size, uint64_t translations)
+{
+    uint32_t i, pid, page;
+    FrameAllocator frames(BENCH_PROCESSES * BENCH_PAGES * page_size, page_size);
+    PageTable page_table(page_size, &frames, NULL, NULL, NULL);
+    std::map<std::string, int> string_table;
+
+    //every page is touched once, so the timed runs only translate resident pages
+    for (pid = 1024; pid < 1024 + BENCH_PROCESSES; pid++)
+    {
+        for (page = 0; page < BENCH_PAGES; page++)
+        {
+            page_table.addEntry(pid, page);
+            int physical = page_table.getPhysicalAddress(pid, page * page_size, true);
+            if (physical < 0)
+            {
+                return false;
+            }
+            string_table[std::to_string(pid) + "|" + std::to_string(page)] = physical / page_size;
+        }
+    }
+
+    //sequential walks the pages of one process after another, random jumps between processes
+    std::vector<BenchAddress> sequential(BENCH_ADDRESSES);
+    std::vector<BenchAddress> random_addresses(BENCH_ADDRESSES);
+    std::minstd_rand random(0);
+    for (i = 0; i < BENCH_ADDRESSES; i++)
+    {
+        sequential[i].pid = 1024 + (i / BENCH_PAGES) % BENCH_PROCESSES;
+        sequential[i].virtual_address = (i % BENCH_PAGES) * page_size;
+        random_addresses[i].pid = 1024 + random() % BENCH_PROCESSES;
+        random_addresses[i].virtual_address = (random() % BENCH_PAGES) * page_size + random() % page_size;
+    }
+
+    printf("Translation benchmark: %u processes x %u pages, %llu translations per run, no TLB\n", BENCH_PROCESSES, BENCH_PAGES,
+           (unsigned long long)translations);
+    printf(" Page table   | Pattern    | Seconds   | Translations/sec\n");
+    printf("--------------+------------+-----------+------------------\n");
+
+    bool passed = true;
+    const char *patterns[2] = {"sequential", "random"};
+    std::vector<BenchAddress> *addresses[2] = {&sequential, &random_addresses};
+    for (i = 0; i < 2; i++)
+    {
+        passed = timeTranslations("string map", patterns[i], *addresses[i], translations, [&](uint32_t pid, uint32_t address) {
+            return stringKeyedLookup(string_table, page_size, pid, address);
+        }) && passed;
+        passed = timeTranslations("radix tree", patterns[i], *addresses[i], translations, [&](uint32_t pid, uint32_t address) {
+            return page_table.getPhysicalAddress(pid, address);
+        }) && passed;
+    }
+    return passed;
+}
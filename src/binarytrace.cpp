@@ -0,0 +1,606 @@
+#include <cstring>
+#include <type_traits>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "binarytrace.h"
+#include "command.h"
+#include "traceio.h"
+#include "snapshot.h"
+
+TraceWriter::TraceWriter()
+{
+    _file = NULL;
+    _next_pid = 1024;
+}
+
+TraceWriter::~TraceWriter()
+{
+    close();
+}
+
+bool TraceWriter::open(std::string path)
+{
+    _file = fopen(path.c_str(), "wb");
+    if (_file == NULL)
+    {
+        return false;
+    }
+
+    putBytes(TRACE_MAGIC, 4);
+    putByte(TRACE_VERSION);
+    putByte(0);
+    putByte(0);
+    putByte(0);
+    return true;
+}
+
+void TraceWriter::close()
+{
+    if (_file == NULL)
+    {
+        return;
+    }
+    putByte(TraceEnd);
+    flushBuffer();
+    fclose(_file);
+    _file = NULL;
+}
+
+void TraceWriter::flushBuffer()
+{
+    if (!_buffer.empty())
+    {
+        fwrite(&_buffer[0], 1, _buffer.size(), _file);
+        _buffer.clear();
+    }
+}
+
+void TraceWriter::putByte(uint8_t value)
+{
+    _buffer.push_back(value);
+}
+
+void TraceWriter::putVarint(uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        _buffer.push_back((uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    _buffer.push_back((uint8_t)value);
+}
+
+void TraceWriter::putSigned(int64_t value)
+{
+    putVarint(((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+}
+
+void TraceWriter::putBytes(const void *data, size_t length)
+{
+    const uint8_t *bytes = (const uint8_t*)data;
+    _buffer.insert(_buffer.end(), bytes, bytes + length);
+}
+
+uint32_t TraceWriter::internName(std::string_view name)
+{
+    std::string key(name);
+    std::unordered_map<std::string, uint32_t>::iterator it = _names.find(key);
+    if (it != _names.end())
+    {
+        return it->second;
+    }
+
+    uint32_t id = _names.size();
+    _names[key] = id;
+    _name_types.push_back(FreeSpace);
+    putByte(TraceName);
+    putVarint(name.length());
+    putBytes(name.data(), name.length());
+    return id;
+}
+
+//a second allocate of a name is rejected if the first one succeeded, and may succeed if it failed
+void TraceWriter::noteType(uint32_t pid, uint32_t name, DataType type)
+{
+    if (pid >= _next_pid)
+    {
+        return;
+    }
+    std::unordered_map<uint32_t, DataType>::iterator it = _types[pid].find(name);
+    if (it == _types[pid].end())
+    {
+        _types[pid][name] = type;
+    }
+    else if (it->second != type)
+    {
+        it->second = FreeSpace;
+    }
+}
+
+void TraceWriter::writeText(std::string_view line)
+{
+    putByte(TraceText);
+    putVarint(line.length());
+    putBytes(line.data(), line.length());
+}
+
+// chars take one byte, floating point values their raw bytes and other
+// integers a zigzag varint
+bool TraceWriter::encodeSetValues(DataType type, size_t first)
+{
+    return visitDataType(type, [&](auto tag) -> bool {
+        typedef typename decltype(tag)::type T;
+        T value;
+        for (size_t i = first; i < _tokens.size(); i++)
+        {
+            if (!ElementTraits<T>::parse(_tokens[i], &value))
+            {
+                return false;
+            }
+            if constexpr (sizeof(T) == 1 || std::is_floating_point<T>::value)
+            {
+                putBytes(&value, sizeof(T));
+            }
+            else
+            {
+                putSigned(value);
+            }
+        }
+        return true;
+    });
+}
+
+void TraceWriter::writeLine(std::string_view line)
+{
+    if (_file == NULL)
+    {
+        return;
+    }
+
+    tokenizeCommand(line, ' ', _tokens);
+    if (_tokens.empty())
+    {
+        return;
+    }
+
+    int text_size, data_size;
+    uint32_t pid, count, offset;
+    DataType type;
+    CommandType command = lookupCommand(_tokens[0]);
+
+    if (command == CmdExit)
+    {
+        //nothing after exit is replayed
+        close();
+        return;
+    }
+    else if (command == CmdCreate && _tokens.size() >= 3 && parseNumber(_tokens[1], &text_size) && parseNumber(_tokens[2], &data_size))
+    {
+        putByte(TraceCreate);
+        putSigned(text_size);
+        putSigned(data_size);
+        _next_pid++;
+    }
+    else if (command == CmdAllocate && _tokens.size() >= 5 && parseNumber(_tokens[1], &pid) && parseNumber(_tokens[4], &count) &&
+             stringToDataType(_tokens[3], &type))
+    {
+        uint32_t name = internName(_tokens[2]);
+        if (_tokens.size() > 5)
+        {
+            //allocations with an explicit alignment are rare enough to keep as text
+            writeText(line);
+        }
+        else
+        {
+            putByte(TraceAllocate);
+            putVarint(pid);
+            putVarint(name);
+            putByte(type);
+            putVarint(count);
+            _name_types[name] = type;
+        }
+
+        noteType(pid, name, type);
+    }
+    else if (command == CmdSet && _tokens.size() >= 4 && parseNumber(_tokens[1], &pid) && parseNumber(_tokens[3], &offset))
+    {
+        uint32_t name = internName(_tokens[2]);
+        std::unordered_map<uint32_t, DataType>::iterator it = _types[pid].find(name);
+        size_t start = _buffer.size();
+        bool encoded = false;
+
+        //the type only goes into the record when the reader can't know it already
+        if (it != _types[pid].end() && it->second != FreeSpace)
+        {
+            bool same = _name_types[name] == it->second;
+            putByte(same ? TraceSetSame : TraceSet);
+            putVarint(pid);
+            putVarint(name);
+            putVarint(offset);
+            if (!same)
+            {
+                putByte(it->second);
+            }
+            putVarint(_tokens.size() - 4);
+            encoded = encodeSetValues(it->second, 4);
+            if (encoded)
+            {
+                _name_types[name] = it->second;
+            }
+        }
+
+        //unknown variable or a value that doesn't parse: keep the line as text so replay reports the same error
+        if (!encoded)
+        {
+            _buffer.resize(start);
+            writeText(line);
+        }
+    }
+    else if (command == CmdFree && _tokens.size() >= 3 && parseNumber(_tokens[1], &pid))
+    {
+        uint32_t name = internName(_tokens[2]);
+        putByte(TraceFree);
+        putVarint(pid);
+        putVarint(name);
+        _types[pid].erase(name);
+    }
+    else if (command == CmdTerminate && _tokens.size() >= 2 && parseNumber(_tokens[1], &pid))
+    {
+        putByte(TraceTerminate);
+        putVarint(pid);
+        _types.erase(pid);
+    }
+    else if (command == CmdFork && _tokens.size() >= 2 && parseNumber(_tokens[1], &pid))
+    {
+        //the child takes the next pid and starts with the parent's variables
+        writeText(line);
+        std::unordered_map<uint32_t, std::unordered_map<uint32_t, DataType> >::iterator it = _types.find(pid);
+        if (it != _types.end())
+        {
+            _types[_next_pid] = it->second;
+        }
+        _next_pid++;
+    }
+    else if (command == CmdRestore && _tokens.size() >= 2)
+    {
+        //the processes are the snapshot's from here on; if it can't be read, sets on them stay text
+        writeText(line);
+        _types.clear();
+        std::unordered_map<uint32_t, std::unordered_map<std::string, DataType> > types;
+        if (readSnapshotTypes(std::string(_tokens[1]), &_next_pid, types))
+        {
+            std::unordered_map<uint32_t, std::unordered_map<std::string, DataType> >::iterator process;
+            for (process = types.begin(); process != types.end(); process++)
+            {
+                std::unordered_map<std::string, DataType>::iterator var;
+                for (var = process->second.begin(); var != process->second.end(); var++)
+                {
+                    _types[process->first][internName(var->first)] = var->second;
+                }
+            }
+        }
+    }
+    else if (command == CmdAttach && _tokens.size() >= 3 && parseNumber(_tokens[1], &pid))
+    {
+        //a segment is a char variable, so later sets on it encode like any other
+        writeText(line);
+        noteType(pid, internName(_tokens[2]), Char);
+    }
+    else
+    {
+        writeText(line);
+    }
+
+    if (_buffer.size() >= (1 << 20))
+    {
+        flushBuffer();
+    }
+}
+
+TraceReader::TraceReader()
+{
+    _data = NULL;
+    _length = 0;
+    _position = 0;
+    _record_start = 0;
+    _finished = false;
+    _corrupt = false;
+}
+
+TraceReader::~TraceReader()
+{
+    if (_data != NULL)
+    {
+        munmap((void*)_data, _length);
+    }
+}
+
+bool TraceReader::open(std::string path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < 8)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    void *data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED)
+    {
+        return false;
+    }
+    madvise(data, info.st_size, MADV_SEQUENTIAL);
+
+    _data = (const uint8_t*)data;
+    _length = info.st_size;
+    if (memcmp(_data, TRACE_MAGIC, 4) != 0 || _data[4] == 0 || _data[4] > TRACE_VERSION)
+    {
+        return false;
+    }
+    _position = 8;
+    return true;
+}
+
+bool TraceReader::getByte(uint8_t *value)
+{
+    if (_position >= _length)
+    {
+        return false;
+    }
+    *value = _data[_position++];
+    return true;
+}
+
+bool TraceReader::getVarint(uint64_t *value)
+{
+    uint64_t result = 0;
+    int shift = 0;
+    while (_position < _length && shift < 64)
+    {
+        uint8_t byte = _data[_position++];
+        result |= (uint64_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            *value = result;
+            return true;
+        }
+        shift += 7;
+    }
+    return false;
+}
+
+bool TraceReader::getVarint32(uint32_t *value)
+{
+    uint64_t result;
+    if (!getVarint(&result) || result > UINT32_MAX)
+    {
+        return false;
+    }
+    *value = (uint32_t)result;
+    return true;
+}
+
+bool TraceReader::getSigned(int64_t *value)
+{
+    uint64_t result;
+    if (!getVarint(&result))
+    {
+        return false;
+    }
+    *value = (int64_t)(result >> 1) ^ -(int64_t)(result & 1);
+    return true;
+}
+
+bool TraceReader::getBytes(size_t length, const uint8_t **data)
+{
+    if (length > _length - _position)
+    {
+        return false;
+    }
+    *data = _data + _position;
+    _position += length;
+    return true;
+}
+
+bool TraceReader::getName(std::string_view *name, uint32_t *id)
+{
+    if (!getVarint32(id) || *id >= _names.size())
+    {
+        return false;
+    }
+    *name = _names[*id];
+    return true;
+}
+
+bool TraceReader::decodeValues(TraceRecord *record)
+{
+    //every value takes at least a byte, so a count the rest of the file can't hold is corrupt
+    if (record->count > _length - _position)
+    {
+        return false;
+    }
+    _values.resize((size_t)record->count * dataTypeSize(record->type));
+    record->values = _values.data();
+
+    return visitDataType(record->type, [&](auto tag) -> bool {
+        typedef typename decltype(tag)::type T;
+        uint8_t *slot = _values.data();
+        for (uint32_t i = 0; i < record->count; i++, slot += sizeof(T))
+        {
+            if constexpr (sizeof(T) == 1 || std::is_floating_point<T>::value)
+            {
+                const uint8_t *bytes;
+                if (!getBytes(sizeof(T), &bytes))
+                {
+                    return false;
+                }
+                memcpy(slot, bytes, sizeof(T));
+            }
+            else
+            {
+                int64_t value;
+                if (!getSigned(&value))
+                {
+                    return false;
+                }
+                ElementTraits<T>::store(slot, (T)value);
+            }
+        }
+        return true;
+    });
+}
+
+//a variable's type, so a corrupt trace can't make one of FreeSpace or an unknown type with no element size
+static bool isVariableType(uint8_t type)
+{
+    return type != FreeSpace && type < NumDataTypes;
+}
+
+bool TraceReader::next(TraceRecord *record)
+{
+    if (_finished || _corrupt)
+    {
+        return false;
+    }
+    if (readRecord(record))
+    {
+        return true;
+    }
+    _corrupt = !_finished;
+    return false;
+}
+
+bool TraceReader::isCorrupt()
+{
+    return _corrupt;
+}
+
+size_t TraceReader::getErrorOffset()
+{
+    return _record_start;
+}
+
+bool TraceReader::readRecord(TraceRecord *record)
+{
+    uint8_t opcode, type;
+    uint32_t length, name;
+    int64_t text_size, data_size;
+    const uint8_t *bytes;
+
+    _record_start = _position;
+    while (getByte(&opcode))
+    {
+        record->opcode = (TraceOpcode)opcode;
+        switch (opcode)
+        {
+            case TraceName:
+                if (!getVarint32(&length) || !getBytes(length, &bytes))
+                {
+                    return false;
+                }
+                _names.push_back(std::string_view((const char*)bytes, length));
+                _name_types.push_back(FreeSpace);
+                _record_start = _position;
+                continue;
+            case TraceCreate:
+                if (!getSigned(&text_size) || !getSigned(&data_size))
+                {
+                    return false;
+                }
+                record->arg1 = (uint32_t)text_size;
+                record->arg2 = (uint32_t)data_size;
+                return true;
+            case TraceAllocate:
+                if (!getVarint32(&record->pid) || !getName(&record->name, &name) || !getByte(&type) || !isVariableType(type) ||
+                    !getVarint32(&record->arg1))
+                {
+                    return false;
+                }
+                record->type = (DataType)type;
+                _name_types[name] = record->type;
+                return true;
+            case TraceSet:
+                if (!getVarint32(&record->pid) || !getName(&record->name, &name) || !getVarint32(&record->arg1) || !getByte(&type) ||
+                    !isVariableType(type) || !getVarint32(&record->count))
+                {
+                    return false;
+                }
+                record->type = (DataType)type;
+                _name_types[name] = record->type;
+                return decodeValues(record);
+            case TraceSetSame:
+                if (!getVarint32(&record->pid) || !getName(&record->name, &name) || !getVarint32(&record->arg1) ||
+                    !isVariableType(_name_types[name]) || !getVarint32(&record->count))
+                {
+                    return false;
+                }
+                record->opcode = TraceSet;
+                record->type = _name_types[name];
+                return decodeValues(record);
+            case TraceFree:
+                return getVarint32(&record->pid) && getName(&record->name, &name);
+            case TraceTerminate:
+                return getVarint32(&record->pid);
+            case TraceText:
+                if (!getVarint32(&length) || !getBytes(length, &bytes))
+                {
+                    return false;
+                }
+                record->text = std::string_view((const char*)bytes, length);
+                return true;
+            case TraceEnd:
+                _finished = true;
+                return false;
+            default:
+                return false;
+        }
+    }
+    return false;
+}
+
+bool isBinaryTrace(std::string path)
+{
+    char magic[4];
+    FILE *file = fopen(path.c_str(), "rb");
+    if (file == NULL)
+    {
+        return false;
+    }
+    bool binary = fread(magic, 1, 4, file) == 4 && memcmp(magic, TRACE_MAGIC, 4) == 0;
+    fclose(file);
+    return binary;
+}
+
+bool convertTrace(std::string text_path, std::string binary_path)
+{
+    LineReader *input = openTrace(text_path);
+    if (input == NULL)
+    {
+        return false;
+    }
+
+    TraceWriter writer;
+    if (!writer.open(binary_path))
+    {
+        delete input;
+        return false;
+    }
+
+    std::string line;
+    while (input->nextLine(line))
+    {
+        writer.writeLine(line);
+    }
+    writer.close();
+    delete input;
+    return true;
+}
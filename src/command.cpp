@@ -0,0 +1,166 @@
+#include <charconv>
+#include "command.h"
+
+void tokenizeCommand(std::string_view text, char d, std::vector<std::string_view>& result)
+{
+    enum states { NONE, IN_WORD, IN_STRING } state = NONE;
+
+    size_t i, start = 0;
+    result.clear();
+    for (i = 0; i < text.length(); i++)
+    {
+        char c = text[i];
+        switch (state) {
+            case NONE:
+                if (c != d)
+                {
+                    if (c == '\"')
+                    {
+                        state = IN_STRING;
+                        start = i + 1;
+                    }
+                    else
+                    {
+                        state = IN_WORD;
+                        start = i;
+                    }
+                }
+                break;
+            case IN_WORD:
+                if (c == d)
+                {
+                    result.push_back(text.substr(start, i - start));
+                    state = NONE;
+                }
+                break;
+            case IN_STRING:
+                if (c == '\"')
+                {
+                    result.push_back(text.substr(start, i - start));
+                    state = NONE;
+                }
+                break;
+        }
+    }
+    if (state != NONE)
+    {
+        result.push_back(text.substr(start));
+    }
+}
+
+CommandType lookupCommand(std::string_view name)
+{
+    //command names are unique by length and first letter, so one compare confirms the match
+    CommandType type = CmdUnknown;
+    std::string_view expected;
+    switch (name.length())
+    {
+        case 3:
+            type = CmdSet;
+            expected = "set";
+            break;
+        case 4:
+            if (name[0] == 'f' && name[1] == 'o')
+            {
+                type = CmdFork;
+                expected = "fork";
+            }
+            else if (name[0] == 'f')
+            {
+                type = CmdFree;
+                expected = "free";
+            }
+            else
+            {
+                type = CmdExit;
+                expected = "exit";
+            }
+            break;
+        case 5:
+            type = CmdPrint;
+            expected = "print";
+            break;
+        case 6:
+            if (name[0] == 'a')
+            {
+                type = CmdAttach;
+                expected = "attach";
+            }
+            else
+            {
+                type = CmdCreate;
+                expected = "create";
+            }
+            break;
+        case 7:
+            type = CmdRestore;
+            expected = "restore";
+            break;
+        case 8:
+            if (name[0] == 's')
+            {
+                type = CmdSnapshot;
+                expected = "snapshot";
+            }
+            else
+            {
+                type = CmdAllocate;
+                expected = "allocate";
+            }
+            break;
+        case 9:
+            type = CmdTerminate;
+            expected = "terminate";
+            break;
+    }
+    return (type != CmdUnknown && name == expected) ? type : CmdUnknown;
+}
+
+template <typename T>
+static bool parseWhole(std::string_view text, T *value)
+{
+    if (text.empty())
+    {
+        return false;
+    }
+    std::from_chars_result result = std::from_chars(text.data(), text.data() + text.length(), *value);
+    return result.ec == std::errc() && result.ptr == text.data() + text.length();
+}
+
+bool parseNumber(std::string_view text, int *value)
+{
+    return parseWhole(text, value);
+}
+
+bool parseNumber(std::string_view text, uint32_t *value)
+{
+    return parseWhole(text, value);
+}
+
+bool parseNumber(std::string_view text, long *value)
+{
+    return parseWhole(text, value);
+}
+
+bool parseNumber(std::string_view text, float *value)
+{
+    return parseWhole(text, value);
+}
+
+bool parseNumber(std::string_view text, double *value)
+{
+    return parseWhole(text, value);
+}
+
+bool stringToDataType(std::string_view text, DataType *type)
+{
+    //both the command name ("int") and the enum name ("Int") are accepted
+#define DATA_TYPE_MATCH(name, ctype, str) \
+    if(text == str || text == #name){ \
+        *type = name; \
+        return true; \
+    }
+    DATA_TYPES(DATA_TYPE_MATCH)
+#undef DATA_TYPE_MATCH
+    return false;
+}
@@ -0,0 +1,111 @@
+#include <thread>
+#include <algorithm>
+#include "epoch.h"
+
+// retired items collected before the writer looks for ones it can release
+#define EPOCH_RECLAIM_BATCH 64
+
+EpochManager::EpochManager()
+{
+    int i;
+    _epoch = 1;
+    _num_readers = 0;
+    _reclaimed = 0;
+    for (i = 0; i < EPOCH_MAX_READERS; i++)
+    {
+        _readers[i] = 0;
+    }
+}
+
+EpochManager::~EpochManager()
+{
+    synchronize();
+}
+
+int EpochManager::registerReader()
+{
+    uint32_t reader = _num_readers.fetch_add(1);
+    if (reader >= EPOCH_MAX_READERS)
+    {
+        _num_readers--;
+        return -1;
+    }
+    return reader;
+}
+
+void EpochManager::enter(int reader)
+{
+    //the writer may move the epoch on before it sees the slot, so the slot is only trusted once the epoch held still
+    uint64_t epoch;
+    do
+    {
+        epoch = _epoch.load();
+        _readers[reader].store(epoch);
+    } while (_epoch.load() != epoch);
+}
+
+void EpochManager::leave(int reader)
+{
+    _readers[reader].store(0);
+}
+
+void EpochManager::retire(std::function<void()> release)
+{
+    RetiredItem item;
+    item.epoch = _epoch.fetch_add(1);
+    item.release = release;
+    _retired.push_back(item);
+
+    if (_retired.size() >= EPOCH_RECLAIM_BATCH)
+    {
+        reclaim();
+    }
+}
+
+void EpochManager::reclaim()
+{
+    uint32_t i;
+    uint64_t oldest = UINT64_MAX;
+    uint32_t num_readers = std::min<uint32_t>(_num_readers.load(), EPOCH_MAX_READERS);
+    for (i = 0; i < num_readers; i++)
+    {
+        uint64_t epoch = _readers[i].load();
+        if (epoch != 0 && epoch < oldest)
+        {
+            oldest = epoch;
+        }
+    }
+
+    //items are retired in epoch order, so the releasable ones are a prefix
+    size_t released = 0;
+    while (released < _retired.size() && _retired[released].epoch < oldest)
+    {
+        _retired[released].release();
+        released++;
+    }
+    _retired.erase(_retired.begin(), _retired.begin() + released);
+    _reclaimed += released;
+}
+
+//releases everything retired so far, waiting for readers still inside
+void EpochManager::synchronize()
+{
+    while (!_retired.empty())
+    {
+        reclaim();
+        if (!_retired.empty())
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+uint64_t EpochManager::getPending()
+{
+    return _retired.size();
+}
+
+uint64_t EpochManager::getReclaimed()
+{
+    return _reclaimed;
+}
@@ -0,0 +1,361 @@
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "frameallocator.h"
+
+FrameAllocator::FrameAllocator(uint32_t memory_size, uint32_t frame_size, std::string path)
+{
+    //without a path memory is anonymous, otherwise the file is grown to the memory size and shared
+    if (path.empty())
+    {
+        _memory = mmap(NULL, memory_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    }
+    else
+    {
+        int fd = open(path.c_str(), O_RDWR | O_CREAT, 0600);
+        _memory = MAP_FAILED;
+        if (fd >= 0 && ftruncate(fd, memory_size) == 0)
+        {
+            _memory = mmap(NULL, memory_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        }
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+    }
+    _mapped = _memory != MAP_FAILED;
+    if (!_mapped)
+    {
+        _memory = NULL;
+    }
+    _memory_size = memory_size;
+    _frame_size = frame_size;
+    _num_frames = memory_size / frame_size;
+    _used_frames = 0;
+    _first_free_word = 0;
+    _used.assign((_num_frames + 63) / 64, 0);
+    _shared = NULL;
+    _batch_size = 0;
+
+    //frames past the end of memory in the last word are marked as permanently used
+    if (_num_frames % 64 != 0)
+    {
+        _used.back() = ~0ULL << (_num_frames % 64);
+    }
+}
+
+FrameAllocator::FrameAllocator(FrameAllocator *shared, uint32_t batch_size)
+{
+    _memory = shared->_memory;
+    _mapped = shared->_mapped;
+    _memory_size = shared->_memory_size;
+    _frame_size = shared->_frame_size;
+    _num_frames = shared->_num_frames;
+    _used_frames = 0;
+    _first_free_word = 0;
+    _shared = shared;
+    _batch_size = batch_size;
+}
+
+FrameAllocator::~FrameAllocator()
+{
+    if (_shared != NULL)
+    {
+        flushCache();
+        return;
+    }
+    if (_mapped)
+    {
+        munmap(_memory, _memory_size);
+    }
+}
+
+int FrameAllocator::allocate()
+{
+    if (_shared == NULL)
+    {
+        return allocateFrame();
+    }
+
+    //refill an empty cache with a batch from the shared bitmap
+    if (_cache.empty())
+    {
+        _cache.resize(_batch_size);
+        _cache.resize(_shared->allocateBatch(&_cache[0], _batch_size));
+        if (_cache.empty())
+        {
+            return -1;
+        }
+    }
+
+    uint32_t frame = _cache.back();
+    _cache.pop_back();
+    _used_frames++;
+    return frame;
+}
+
+// count frames in a row, starting at a multiple of count; count has to be a
+// multiple of 64 so the run covers whole bitmap words. The frames are
+// released one by one.
+int FrameAllocator::allocateRun(uint32_t count)
+{
+    if (_shared == NULL)
+    {
+        return allocateRunFrames(count);
+    }
+
+    int first;
+    {
+        std::lock_guard<std::mutex> guard(_shared->_lock);
+        first = _shared->allocateRunFrames(count);
+    }
+    if (first >= 0)
+    {
+        _used_frames += count;
+    }
+    return first;
+}
+
+void FrameAllocator::release(uint32_t frame)
+{
+    if (_shared == NULL)
+    {
+        releaseFrame(frame);
+        return;
+    }
+
+    //a cache holding two batches gives one back
+    _cache.push_back(frame);
+    _used_frames--;
+    if (_cache.size() >= 2 * _batch_size)
+    {
+        _shared->releaseBatch(&_cache[_batch_size], _cache.size() - _batch_size);
+        _cache.resize(_batch_size);
+    }
+}
+
+//takes the given frame out of the free frames, false if it is already in use
+bool FrameAllocator::claim(uint32_t frame)
+{
+    if (_shared != NULL || frame >= _num_frames || isAllocated(frame))
+    {
+        return false;
+    }
+    _used[frame / 64] |= 1ULL << (frame % 64);
+    _used_frames++;
+    return true;
+}
+
+void FrameAllocator::flushCache()
+{
+    if (_shared != NULL && !_cache.empty())
+    {
+        _shared->releaseBatch(&_cache[0], _cache.size());
+        _cache.clear();
+    }
+}
+
+uint32_t FrameAllocator::allocateBatch(uint32_t *frames, uint32_t count)
+{
+    std::lock_guard<std::mutex> guard(_lock);
+
+    uint32_t i;
+    for (i = 0; i < count; i++)
+    {
+        int frame = allocateFrame();
+        if (frame < 0)
+        {
+            break;
+        }
+        frames[i] = frame;
+    }
+    return i;
+}
+
+void FrameAllocator::releaseBatch(const uint32_t *frames, uint32_t count)
+{
+    std::lock_guard<std::mutex> guard(_lock);
+
+    uint32_t i;
+    for (i = 0; i < count; i++)
+    {
+        releaseFrame(frames[i]);
+    }
+}
+
+int FrameAllocator::allocateFrame()
+{
+    uint32_t word;
+    for (word = _first_free_word; word < _used.size(); word++)
+    {
+        if (_used[word] != ~0ULL)
+        {
+            break;
+        }
+    }
+    _first_free_word = word;
+
+    //out of physical memory
+    if (word == _used.size())
+    {
+        return -1;
+    }
+
+    uint32_t bit = __builtin_ctzll(~_used[word]);
+    _used[word] |= 1ULL << bit;
+    _used_frames++;
+
+    return word * 64 + bit;
+}
+
+int FrameAllocator::allocateRunFrames(uint32_t count)
+{
+    uint32_t words = count / 64;
+    uint32_t word, i;
+    for (word = _first_free_word - _first_free_word % words; word + words <= _used.size(); word += words)
+    {
+        for (i = 0; i < words; i++)
+        {
+            if (_used[word + i] != 0)
+            {
+                break;
+            }
+        }
+        if (i == words)
+        {
+            for (i = 0; i < words; i++)
+            {
+                _used[word + i] = ~0ULL;
+            }
+            _used_frames += count;
+            return word * 64;
+        }
+    }
+    return -1;
+}
+
+void FrameAllocator::releaseFrame(uint32_t frame)
+{
+    if (!isAllocated(frame))
+    {
+        return;
+    }
+
+    uint32_t word = frame / 64;
+    _used[word] &= ~(1ULL << (frame % 64));
+    _used_frames--;
+
+    if (word < _first_free_word)
+    {
+        _first_free_word = word;
+    }
+}
+
+bool FrameAllocator::isAllocated(uint32_t frame)
+{
+    if (_shared != NULL)
+    {
+        return _shared->isAllocated(frame);
+    }
+    if (frame >= _num_frames)
+    {
+        return false;
+    }
+    return (_used[frame / 64] >> (frame % 64)) & 1;
+}
+
+//runs of frames in use are written with one call each
+bool FrameAllocator::writeImage(int fd, uint64_t offset)
+{
+    if (ftruncate(fd, offset + _memory_size) != 0)
+    {
+        return false;
+    }
+
+    uint32_t frame = 0;
+    while (frame < _num_frames)
+    {
+        if (!isAllocated(frame))
+        {
+            frame++;
+            continue;
+        }
+        uint32_t end = frame + 1;
+        while (end < _num_frames && isAllocated(end))
+        {
+            end++;
+        }
+
+        const char *data = (const char*)_memory + (size_t)frame * _frame_size;
+        size_t length = (size_t)(end - frame) * _frame_size;
+        off_t position = offset + (uint64_t)frame * _frame_size;
+        while (length > 0)
+        {
+            ssize_t written = pwrite(fd, data, length, position);
+            if (written <= 0)
+            {
+                return false;
+            }
+            data += written;
+            length -= written;
+            position += written;
+        }
+        frame = end;
+    }
+    return true;
+}
+
+//the mapping goes over the current one at the same address, so frame addresses stay valid
+bool FrameAllocator::mapImage(int fd, uint64_t offset)
+{
+    if (_shared != NULL || !_mapped)
+    {
+        return false;
+    }
+    void *memory = mmap(_memory, _memory_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, offset);
+    return memory == _memory;
+}
+
+bool FrameAllocator::isOpen()
+{
+    return _mapped;
+}
+
+void *FrameAllocator::getMemory()
+{
+    return _memory;
+}
+
+uint32_t FrameAllocator::getMemorySize()
+{
+    return _memory_size;
+}
+
+uint32_t FrameAllocator::getFrameSize()
+{
+    return _frame_size;
+}
+
+uint32_t FrameAllocator::getNumFrames()
+{
+    return _num_frames;
+}
+
+//a frame cache reports the shared counts, which include frames sitting unused in caches
+uint32_t FrameAllocator::getUsedFrames()
+{
+    return _shared == NULL ? _used_frames : _shared->getUsedFrames();
+}
+
+uint32_t FrameAllocator::getFreeFrames()
+{
+    return _num_frames - getUsedFrames();
+}
+
+void FrameAllocator::print()
+{
+    std::cout << "Frames in use: " << getUsedFrames() << std::endl;
+    std::cout << "Frames free:   " << getFreeFrames() << std::endl;
+    std::cout << "Total frames:  " << _num_frames << " (" << _frame_size << " bytes each)" << std::endl;
+}
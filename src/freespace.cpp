@@ -0,0 +1,373 @@
+#include <algorithm>
+#include "freespace.h"
+
+FreeSpaceIndex::FreeSpaceIndex()
+{
+    _root = NULL;
+    _total_free = 0;
+    _seed = 2463534242u;
+    std::fill(_histogram, _histogram + FREE_HISTOGRAM_BUCKETS, 0);
+}
+
+FreeSpaceIndex::~FreeSpaceIndex()
+{
+    destroy(_root);
+}
+
+uint32_t FreeSpaceIndex::nextPriority()
+{
+    //xorshift32, treap priorities only need to be well spread
+    _seed ^= _seed << 13;
+    _seed ^= _seed >> 17;
+    _seed ^= _seed << 5;
+    return _seed;
+}
+
+void FreeSpaceIndex::update(FreeExtent *node)
+{
+    node->max_size = node->size;
+    if (node->left != NULL && node->left->max_size > node->max_size)
+    {
+        node->max_size = node->left->max_size;
+    }
+    if (node->right != NULL && node->right->max_size > node->max_size)
+    {
+        node->max_size = node->right->max_size;
+    }
+}
+
+//left receives every extent starting below address, right the rest
+void FreeSpaceIndex::split(FreeExtent *node, uint32_t address, FreeExtent **left, FreeExtent **right)
+{
+    if (node == NULL)
+    {
+        *left = NULL;
+        *right = NULL;
+        return;
+    }
+
+    if (node->address < address)
+    {
+        split(node->right, address, &node->right, right);
+        *left = node;
+    }
+    else
+    {
+        split(node->left, address, left, &node->left);
+        *right = node;
+    }
+    update(node);
+}
+
+FreeExtent* FreeSpaceIndex::merge(FreeExtent *left, FreeExtent *right)
+{
+    if (left == NULL)
+    {
+        return right;
+    }
+    if (right == NULL)
+    {
+        return left;
+    }
+
+    if (left->priority > right->priority)
+    {
+        left->right = merge(left->right, right);
+        update(left);
+        return left;
+    }
+    right->left = merge(left, right->left);
+    update(right);
+    return right;
+}
+
+FreeExtent* FreeSpaceIndex::detachFirst(FreeExtent **node)
+{
+    FreeExtent *current = *node;
+    if (current == NULL)
+    {
+        return NULL;
+    }
+
+    if (current->left == NULL)
+    {
+        *node = current->right;
+        current->right = NULL;
+        update(current);
+        return current;
+    }
+
+    FreeExtent *first = detachFirst(&current->left);
+    update(current);
+    return first;
+}
+
+FreeExtent* FreeSpaceIndex::detachLast(FreeExtent **node)
+{
+    FreeExtent *current = *node;
+    if (current == NULL)
+    {
+        return NULL;
+    }
+
+    if (current->right == NULL)
+    {
+        *node = current->left;
+        current->left = NULL;
+        update(current);
+        return current;
+    }
+
+    FreeExtent *last = detachLast(&current->right);
+    update(current);
+    return last;
+}
+
+FreeExtent* FreeSpaceIndex::newExtent(uint32_t address, uint32_t size)
+{
+    FreeExtent *node = new FreeExtent();
+    node->address = address;
+    node->size = size;
+    node->max_size = size;
+    node->priority = nextPriority();
+    node->left = NULL;
+    node->right = NULL;
+    _by_size.insert(std::make_pair(size, address));
+    _histogram[31 - __builtin_clz(size)]++;
+    return node;
+}
+
+void FreeSpaceIndex::deleteExtent(FreeExtent *node)
+{
+    _by_size.erase(std::make_pair(node->size, node->address));
+    _histogram[31 - __builtin_clz(node->size)]--;
+    delete node;
+}
+
+void FreeSpaceIndex::destroy(FreeExtent *node)
+{
+    if (node == NULL)
+    {
+        return;
+    }
+    destroy(node->left);
+    destroy(node->right);
+    delete node;
+}
+
+void FreeSpaceIndex::collect(FreeExtent *node, std::vector<std::pair<uint32_t, uint32_t> >& result)
+{
+    if (node == NULL)
+    {
+        return;
+    }
+    collect(node->left, result);
+    result.push_back(std::make_pair(node->address, node->size));
+    collect(node->right, result);
+}
+
+void FreeSpaceIndex::release(uint32_t address, uint32_t size)
+{
+    if (size == 0)
+    {
+        return;
+    }
+    _total_free += size;
+
+    FreeExtent *left, *right;
+    split(_root, address, &left, &right);
+
+    //coalesce with the hole ending right where this one starts
+    FreeExtent *before = detachLast(&left);
+    if (before != NULL && before->address + before->size == address)
+    {
+        address = before->address;
+        size += before->size;
+        deleteExtent(before);
+    }
+    else if (before != NULL)
+    {
+        left = merge(left, before);
+    }
+
+    //coalesce with the hole starting right where this one ends
+    FreeExtent *after = detachFirst(&right);
+    if (after != NULL && address + size == after->address)
+    {
+        size += after->size;
+        deleteExtent(after);
+    }
+    else if (after != NULL)
+    {
+        right = merge(after, right);
+    }
+
+    _root = merge(merge(left, newExtent(address, size)), right);
+}
+
+bool FreeSpaceIndex::reserve(uint32_t address, uint32_t size)
+{
+    if (size == 0)
+    {
+        return true;
+    }
+
+    //the extent holding address is the last one starting at or below it
+    FreeExtent *left, *right;
+    split(_root, address + 1, &left, &right);
+    FreeExtent *extent = detachLast(&left);
+    if (extent == NULL || (uint64_t)extent->address + extent->size < (uint64_t)address + size)
+    {
+        if (extent != NULL)
+        {
+            left = merge(left, extent);
+        }
+        _root = merge(left, right);
+        return false;
+    }
+
+    uint32_t start = extent->address;
+    uint32_t end = extent->address + extent->size;
+    deleteExtent(extent);
+
+    if (start < address)
+    {
+        left = merge(left, newExtent(start, address - start));
+    }
+    if (address + size < end)
+    {
+        right = merge(newExtent(address + size, end - (address + size)), right);
+    }
+
+    _root = merge(left, right);
+    _total_free -= size;
+    return true;
+}
+
+bool FreeSpaceIndex::firstFit(uint32_t size, uint32_t *address)
+{
+    FreeExtent *node = _root;
+    while (node != NULL && node->max_size >= size)
+    {
+        if (node->left != NULL && node->left->max_size >= size)
+        {
+            node = node->left;
+        }
+        else if (node->size >= size)
+        {
+            *address = node->address;
+            return true;
+        }
+        else
+        {
+            node = node->right;
+        }
+    }
+    return false;
+}
+
+//lowest addressed extent starting at or after start that holds size bytes
+FreeExtent* FreeSpaceIndex::fitFrom(FreeExtent *node, uint32_t start, uint32_t size)
+{
+    if (node == NULL || node->max_size < size)
+    {
+        return NULL;
+    }
+    if (node->address < start)
+    {
+        return fitFrom(node->right, start, size);
+    }
+
+    FreeExtent *found = fitFrom(node->left, start, size);
+    if (found != NULL)
+    {
+        return found;
+    }
+    if (node->size >= size)
+    {
+        return node;
+    }
+    return fitFrom(node->right, start, size);
+}
+
+bool FreeSpaceIndex::firstFitFrom(uint32_t start, uint32_t size, uint32_t *address)
+{
+    FreeExtent *node = fitFrom(_root, start, size);
+    if (node == NULL)
+    {
+        return false;
+    }
+    *address = node->address;
+    return true;
+}
+
+bool FreeSpaceIndex::bestFit(uint32_t size, uint32_t *address)
+{
+    std::set<std::pair<uint32_t, uint32_t> >::iterator it = _by_size.lower_bound(std::make_pair(size, 0u));
+    if (it == _by_size.end())
+    {
+        return false;
+    }
+    *address = it->second;
+    return true;
+}
+
+bool FreeSpaceIndex::worstFit(uint32_t size, uint32_t *address)
+{
+    if (_by_size.empty() || _by_size.rbegin()->first < size)
+    {
+        return false;
+    }
+    *address = _by_size.rbegin()->second;
+    return true;
+}
+
+bool FreeSpaceIndex::findContaining(uint32_t address, uint32_t *start, uint32_t *size)
+{
+    FreeExtent *node = _root;
+    while (node != NULL)
+    {
+        if (address < node->address)
+        {
+            node = node->left;
+        }
+        else if (address >= node->address + node->size)
+        {
+            node = node->right;
+        }
+        else
+        {
+            *start = node->address;
+            *size = node->size;
+            return true;
+        }
+    }
+    return false;
+}
+
+uint64_t FreeSpaceIndex::getTotalFree()
+{
+    return _total_free;
+}
+
+uint32_t FreeSpaceIndex::getLargest()
+{
+    return (_root == NULL) ? 0 : _root->max_size;
+}
+
+uint32_t FreeSpaceIndex::getCount()
+{
+    return _by_size.size();
+}
+
+const uint32_t* FreeSpaceIndex::getHistogram()
+{
+    return _histogram;
+}
+
+std::vector<std::pair<uint32_t, uint32_t> > FreeSpaceIndex::getExtents()
+{
+    std::vector<std::pair<uint32_t, uint32_t> > result;
+    collect(_root, result);
+    return result;
+}
@@ -1,306 +1,1302 @@
 #include <iostream>
 #include <string>
+#include <string_view>
 #include <cstring>
+#include <chrono>
 #include "mmu.h"
 #include "pagetable.h"
+#include "frameallocator.h"
+#include "tlb.h"
+#include "replacement.h"
+#include "swap.h"
+#include "stats.h"
+#include "traceio.h"
+#include "command.h"
+#include "binarytrace.h"
+#include "shard.h"
+#include "stress.h"
+#include "bench.h"
+#include "snapshot.h"
+
+typedef struct SimulatorOptions {
+    int page_size;
+    uint32_t num_frames;
+    uint32_t tlb_entries;
+    uint32_t tlb_ways;
+    TlbPolicy tlb_policy;
+    AllocationPolicyType alloc_policy;
+    ReplacementPolicyType replacement;
+    std::string swap_path;
+    std::string memory_path; // file backing physical memory, anonymous memory if empty
+    bool large_pages;
+    uint64_t merge_every; // commands between same page merge passes, 0 to never merge
+} SimulatorOptions;
+
+typedef struct Simulator {
+    Mmu *mmu;
+    PageTable *page_table;
+    FrameAllocator *frames;
+    Tlb *tlb;
+    ReplacementPolicy *replacement;
+    SwapSpace *swap;
+    StatsEngine *stats;
+    uint64_t stats_every; // commands between time series samples
+    uint64_t merge_every; // commands between same page merge passes
+    void *memory;
+    int page_size;
+    bool quiet; // reference collection pass: table prints are skipped
+    std::ostream *out; // command output, a per command buffer when sharded
+    std::vector<Mmu*> mmus; // every shard, for the table prints
+    std::vector<PageTable*> page_tables;
+    std::vector<Tlb*> tlbs;
+    std::vector<uint8_t> values; // staging buffer for parsed set values
+    std::string name; // reused for variable name lookups so they don't allocate
+    std::vector<std::string_view> args; // tokens of a command run by a shard worker
+} Simulator;
+
+//Simulators split by pid, each run by its own worker thread
+typedef struct ShardedSimulator {
+    std::vector<Simulator*> shards;
+    FrameAllocator *frames; // shared physical memory, each shard allocates through its own frame cache
+    ShardPool *pool;
+    uint32_t next_pid; // pid the next create hands out
+} ShardedSimulator;
+
+//Shard number for table prints that have to wait for every shard
+#define SHARD_ALL -1
+
+//Frames a shard moves between its frame cache and the shared allocator at once
+#define SHARD_FRAME_BATCH 32
+
+//Commands that may be in flight at once
+#define SHARD_WINDOW 4096
+
+typedef void (*CommandHandler)(std::vector<std::string_view>& args, Simulator *sim);
 
 void printStartMessage(int page_size);
-void createProcess(int text_size, int data_size, Mmu *mmu, PageTable *page_table);
-void allocateVariable(uint32_t pid, std::string var_name, DataType type, uint32_t num_elements, Mmu *mmu, PageTable *page_table);
-void setVariable(uint32_t pid, std::string var_name, uint32_t offset, void *value, Mmu *mmu, PageTable *page_table, void *memory);
-void freeVariable(uint32_t pid, std::string var_name, Mmu *mmu, PageTable *page_table);
+Simulator* createSimulator(SimulatorOptions& options, const std::vector<uint64_t>& references, FrameAllocator *frames);
+void destroySimulator(Simulator *sim);
+ShardedSimulator* createShards(SimulatorOptions& options, const std::vector<uint64_t>& references, uint32_t num_shards);
+void destroyShards(ShardedSimulator *sharded);
+uint64_t runCommands(LineReader *trace, TraceReader *replay, TraceWriter *recorder, Simulator *sim, uint64_t flush_every);
+uint64_t runShardedCommands(LineReader *trace, TraceReader *replay, TraceWriter *recorder, ShardedSimulator *sharded, uint64_t flush_every);
+void runShardTask(ShardTask *task, uint32_t shard, std::ostream& out, void *context);
+int routeCommand(CommandType type, std::vector<std::string_view>& args, ShardedSimulator *sharded, uint32_t *create_pid);
+void synchronizeShards(ShardedSimulator *sharded);
+void mergeShards(ShardedSimulator *sharded);
+bool openCommands(std::string trace_path, LineReader **trace, TraceReader **replay);
+bool collectReferences(SimulatorOptions& options, std::string trace_path, std::vector<uint64_t>& references);
+bool runScaling(SimulatorOptions& options, std::string trace_path, const std::vector<uint64_t>& references, uint32_t max_threads);
+bool nextCommand(LineReader *trace, std::string& command);
+void createProcess(int text_size, int data_size, Mmu *mmu, PageTable *page_table, std::ostream& out);
+void allocateVariable(uint32_t pid, std::string var_name, DataType type, uint32_t num_elements, uint32_t alignment, Mmu *mmu, PageTable *page_table, std::ostream& out);
+void printVariable(uint32_t pid, Variable *var, PageTable *page_table, std::ostream& out);
+void freeVariable(uint32_t pid, Variable *var, Mmu *mmu, PageTable *page_table);
 void terminateProcess(uint32_t pid, Mmu *mmu, PageTable *page_table);
-uint32_t adjustAddressForBoundry(uint32_t address, uint32_t n, uint32_t num_elements, uint32_t page_size);
+void forkProcess(uint32_t pid, Mmu *mmu, PageTable *page_table, std::ostream& out);
+void attachSegment(uint32_t pid, std::string var_name, uint32_t size, Mmu *mmu, PageTable *page_table, std::ostream& out);
+
+//Command Handlers
+void handleUnknown(std::vector<std::string_view>& args, Simulator *sim);
+void handleCreate(std::vector<std::string_view>& args, Simulator *sim);
+void handleAllocate(std::vector<std::string_view>& args, Simulator *sim);
+void handleSet(std::vector<std::string_view>& args, Simulator *sim);
+void handleFree(std::vector<std::string_view>& args, Simulator *sim);
+void handleTerminate(std::vector<std::string_view>& args, Simulator *sim);
+void handlePrint(std::vector<std::string_view>& args, Simulator *sim);
+void handleFork(std::vector<std::string_view>& args, Simulator *sim);
+void handleAttach(std::vector<std::string_view>& args, Simulator *sim);
+void handleSnapshot(std::vector<std::string_view>& args, Simulator *sim);
+void handleRestore(std::vector<std::string_view>& args, Simulator *sim);
+
+//Shared by the text handlers and binary trace replay
+void runAllocate(uint32_t pid, std::string_view var_name, DataType type, uint32_t num_elements, uint32_t alignment, Simulator *sim);
+bool findSetTarget(uint32_t pid, std::string_view var_name, Simulator *sim, Variable *var);
+void setValues(uint32_t pid, Variable *var, uint32_t offset, const void *values, uint32_t count, Simulator *sim);
+void runFree(uint32_t pid, std::string_view var_name, Simulator *sim);
+void runTerminate(uint32_t pid, Simulator *sim);
+void replayRecord(TraceRecord& record, std::vector<std::string_view>& args, Simulator *sim);
+
+//Indexed by CommandType
+static const CommandHandler command_handlers[NumCommandTypes] = {
+    handleUnknown, handleCreate, handleAllocate, handleSet, handleFree, handleTerminate, handlePrint, handleUnknown, handleFork, handleAttach, handleSnapshot, handleRestore
+};
 
 //Command Conversion Methods
-void splitString(std::string text, char d, std::vector<std::string>& result);
 void vectorOfStringsToArrayOfCharArrays(std::vector<std::string>& list, char ***result);
 void freeArrayOfCharArrays(char **array, size_t array_length);
-DataType stringToDataType(std::string text);
 
 int main(int argc, char **argv)
 {
+    // Convert a text trace to the binary trace format and exit
+    if (argc >= 2 && strcmp(argv[1], "--convert") == 0)
+    {
+        if (argc < 4)
+        {
+            fprintf(stderr, "Usage: %s --convert <text_trace> <binary_trace>\n", argv[0]);
+            return 1;
+        }
+        if (!convertTrace(argv[2], argv[3]))
+        {
+            fprintf(stderr, "Error: could not convert '%s' to '%s'\n", argv[2], argv[3]);
+            return 1;
+        }
+        return 0;
+    }
+
     // Ensure user specified page size as a command line parameter
     if (argc < 2)
     {
         fprintf(stderr, "Error: you must specify the page size\n");
+        fprintf(stderr, "Usage: %s <page_size> [--tlb-entries=N] [--tlb-ways=N] [--tlb-policy=lru|clock]\n"
+                        "       [--policy=first|next|best|worst|segregated|buddy]\n"
+                        "       [--frames=N] [--memory-file=<file>] [--replacement=fifo|lru|clock|lfu|opt] [--swap-file=<file>]\n"
+                        "       [--batch | --trace=<file>] [--flush-every=N] [--record=<file>]\n"
+                        "       [--stats-file=<file.csv|file.json>] [--stats-every=N] [--threads=N] [--scaling=N]\n"
+                        "       [--stress-translate=N] [--bench-translate=N] [--large-pages] [--merge-every=N]\n"
+                        "       %s --convert <text_trace> <binary_trace>\n", argv[0], argv[0]);
+        return 1;
+    }
+
+    // Optional simulator settings
+    SimulatorOptions options;
+    options.page_size = std::stoi(argv[1]);
+    options.num_frames = 67108864 / options.page_size; // 64 MB (64 * 1024 * 1024)
+    options.tlb_entries = 64;
+    options.tlb_ways = 4;
+    options.tlb_policy = TlbLru;
+    options.alloc_policy = FirstFit;
+    options.replacement = ReplaceFifo;
+    options.large_pages = false;
+    options.merge_every = 0;
+    bool batch = false;
+    std::string trace_path = "-";
+    uint64_t flush_every = 0;
+    std::string record_path;
+    std::string stats_path;
+    uint64_t stats_every = 1000;
+    uint32_t num_threads = 1;
+    uint32_t scaling_threads = 0;
+    uint32_t stress_readers = 0;
+    uint64_t bench_translations = 0;
+    for (int i = 2; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool valid = true;
+        if (arg.compare(0, 14, "--tlb-entries=") == 0)
+        {
+            options.tlb_entries = std::stoul(arg.substr(14));
+        }
+        else if (arg.compare(0, 11, "--tlb-ways=") == 0)
+        {
+            options.tlb_ways = std::stoul(arg.substr(11));
+        }
+        else if (arg.compare(0, 13, "--tlb-policy=") == 0)
+        {
+            options.tlb_policy = stringToTlbPolicy(arg.substr(13), &valid);
+        }
+        else if (arg.compare(0, 9, "--policy=") == 0)
+        {
+            options.alloc_policy = stringToAllocationPolicy(arg.substr(9), &valid);
+        }
+        else if (arg.compare(0, 9, "--frames=") == 0)
+        {
+            options.num_frames = std::stoul(arg.substr(9));
+            valid = options.num_frames > 0 && (uint64_t)options.num_frames * options.page_size <= 0xFFFFFFFFULL;
+        }
+        else if (arg.compare(0, 14, "--replacement=") == 0)
+        {
+            options.replacement = stringToReplacementPolicy(arg.substr(14), &valid);
+        }
+        else if (arg.compare(0, 12, "--swap-file=") == 0)
+        {
+            options.swap_path = arg.substr(12);
+        }
+        else if (arg.compare(0, 14, "--memory-file=") == 0)
+        {
+            options.memory_path = arg.substr(14);
+        }
+        else if (arg == "--large-pages")
+        {
+            options.large_pages = true;
+        }
+        else if (arg.compare(0, 14, "--merge-every=") == 0)
+        {
+            options.merge_every = std::stoull(arg.substr(14));
+        }
+        else if (arg == "--batch")
+        {
+            batch = true;
+        }
+        else if (arg.compare(0, 8, "--trace=") == 0)
+        {
+            batch = true;
+            trace_path = arg.substr(8);
+        }
+        else if (arg.compare(0, 14, "--flush-every=") == 0)
+        {
+            flush_every = std::stoull(arg.substr(14));
+        }
+        else if (arg.compare(0, 9, "--record=") == 0)
+        {
+            record_path = arg.substr(9);
+        }
+        else if (arg.compare(0, 13, "--stats-file=") == 0)
+        {
+            stats_path = arg.substr(13);
+        }
+        else if (arg.compare(0, 14, "--stats-every=") == 0)
+        {
+            stats_every = std::stoull(arg.substr(14));
+            valid = stats_every > 0;
+        }
+        else if (arg.compare(0, 10, "--threads=") == 0)
+        {
+            num_threads = std::stoul(arg.substr(10));
+            valid = num_threads > 0;
+        }
+        else if (arg.compare(0, 10, "--scaling=") == 0)
+        {
+            scaling_threads = std::stoul(arg.substr(10));
+            valid = scaling_threads > 0;
+        }
+        else if (arg.compare(0, 19, "--stress-translate=") == 0)
+        {
+            stress_readers = std::stoul(arg.substr(19));
+            valid = stress_readers > 0 && stress_readers <= EPOCH_MAX_READERS;
+        }
+        else if (arg.compare(0, 18, "--bench-translate=") == 0)
+        {
+            bench_translations = std::stoull(arg.substr(18));
+            valid = bench_translations > 0;
+        }
+        else
+        {
+            valid = false;
+        }
+
+        if (!valid)
+        {
+            fprintf(stderr, "Error: unrecognized option '%s'\n", argv[i]);
+            return 1;
+        }
+    }
+
+    // Commands of different processes run on worker threads, which only makes sense for a trace
+    if (num_threads > 1 && !batch)
+    {
+        fprintf(stderr, "Error: --threads requires --batch or --trace=<file>\n");
+        return 1;
+    }
+    if (scaling_threads > 0 && trace_path == "-")
+    {
+        fprintf(stderr, "Error: --scaling requires --trace=<file>\n");
         return 1;
     }
 
-    // Print opening instuction message
-    int page_size = std::stoi(argv[1]);
-    printStartMessage(page_size);
+    // Hammers the lock free translation path with N reader threads against one writer
+    if (stress_readers > 0)
+    {
+        return runTranslationStress(options.page_size, stress_readers, STRESS_OPERATIONS) ? 0 : 1;
+    }
+
+    // Times translations alone, through the radix tree and the string keyed map it replaced
+    if (bench_translations > 0)
+    {
+        return runTranslationBenchmark(options.page_size, bench_translations) ? 0 : 1;
+    }
+
+    // OPT needs the whole reference string up front, so it only works on a trace file that can be read twice
+    std::vector<uint64_t> references;
+    if (options.replacement == ReplaceOpt)
+    {
+        if (trace_path == "-")
+        {
+            fprintf(stderr, "Error: --replacement=opt requires --trace=<file>\n");
+            return 1;
+        }
+        if (!collectReferences(options, trace_path, references))
+        {
+            fprintf(stderr, "Error: could not open trace '%s'\n", trace_path.c_str());
+            return 1;
+        }
+    }
+
+    // Replay the trace with 1 up to N threads and report the throughput of each run
+    if (scaling_threads > 0)
+    {
+        if (!runScaling(options, trace_path, references, scaling_threads))
+        {
+            fprintf(stderr, "Error: could not replay trace '%s'\n", trace_path.c_str());
+            return 1;
+        }
+        return 0;
+    }
+
+    // Batch mode replays a trace without prompts, buffering all output until the end
+    LineReader *trace = NULL;
+    TraceReader *replay = NULL;
+    StdioOutput batch_output;
+    std::streambuf *console_output = NULL;
+    if (batch)
+    {
+        // Binary traces are recognized by their header and replayed record by record
+        if (trace_path != "-" && isBinaryTrace(trace_path))
+        {
+            replay = new TraceReader();
+            if (!replay->open(trace_path))
+            {
+                fprintf(stderr, "Error: '%s' is not a supported binary trace\n", trace_path.c_str());
+                return 1;
+            }
+        }
+        else
+        {
+            trace = openTrace(trace_path);
+        }
+        if (trace == NULL && replay == NULL)
+        {
+            fprintf(stderr, "Error: could not open trace '%s'\n", trace_path.c_str());
+            return 1;
+        }
+        setvbuf(stdout, NULL, _IOFBF, 1 << 20);
+        console_output = std::cout.rdbuf(&batch_output);
+    }
+    else
+    {
+        // Print opening instuction message
+        printStartMessage(options.page_size);
+    }
+
+    // Create physical 'memory', MMU, TLB and Page Table, one set per shard when sharded
+    ShardedSimulator *sharded = NULL;
+    Simulator *sim;
+    bool swap_open = true;
+    if (num_threads > 1)
+    {
+        sharded = createShards(options, references, num_threads);
+        sim = sharded->shards[0];
+        for (uint32_t i = 0; i < sharded->shards.size(); i++)
+        {
+            swap_open = swap_open && sharded->shards[i]->swap->isOpen();
+        }
+    }
+    else
+    {
+        sim = createSimulator(options, references, new FrameAllocator(options.num_frames * options.page_size, options.page_size, options.memory_path));
+        swap_open = sim->swap->isOpen();
+    }
+    if (!sim->frames->isOpen())
+    {
+        fprintf(stderr, "Error: could not map memory file '%s'\n", options.memory_path.c_str());
+        return 1;
+    }
+    if (!swap_open)
+    {
+        fprintf(stderr, "Error: could not open swap file '%s'\n", options.swap_path.c_str());
+        return 1;
+    }
+
+    // Optionally sample memory statistics into a time series while commands run
+    sim->stats_every = stats_every;
+    if (!stats_path.empty() && !sim->stats->openSeries(stats_path))
+    {
+        fprintf(stderr, "Error: could not open '%s' for statistics\n", stats_path.c_str());
+        return 1;
+    }
+
+    // Optionally record every command line into a binary trace
+    TraceWriter *recorder = NULL;
+    if (!record_path.empty())
+    {
+        recorder = new TraceWriter();
+        if (!recorder->open(record_path))
+        {
+            fprintf(stderr, "Error: could not open '%s' for recording\n", record_path.c_str());
+            return 1;
+        }
+    }
+
+    // Prompt loop
+    int exit_status = 0;
+    std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+    uint64_t num_commands = sharded != NULL ? runShardedCommands(trace, replay, recorder, sharded, flush_every)
+                                            : runCommands(trace, replay, recorder, sim, flush_every);
+
+    if (batch)
+    {
+        std::cout.rdbuf(console_output);
+        fflush(stdout);
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+        fprintf(stderr, "Replayed %llu commands in %.3f s (%.0f commands/sec)\n", (unsigned long long)num_commands,
+                seconds, seconds > 0 ? num_commands / seconds : 0.0);
+        if (replay != NULL && replay->isCorrupt())
+        {
+            fprintf(stderr, "error: corrupt trace at offset %zu\n", replay->getErrorOffset());
+            exit_status = 1;
+        }
+        delete trace;
+        delete replay;
+    }
+    delete recorder;
+
+    // Cean up
+    if (sharded != NULL)
+    {
+        destroyShards(sharded);
+    }
+    else
+    {
+        destroySimulator(sim);
+    }
+
+    return exit_status;
+}
+
+//frames is owned by the simulator from here on
+Simulator* createSimulator(SimulatorOptions& options, const std::vector<uint64_t>& references, FrameAllocator *frames)
+{
+    uint32_t mem_size = 67108864;
+
+    Simulator *sim = new Simulator();
+    sim->frames = frames;
+    sim->memory = sim->frames->getMemory();
+    sim->mmu = new Mmu(mem_size, options.page_size, options.alloc_policy);
+    sim->tlb = new Tlb(options.tlb_entries, options.tlb_ways, options.tlb_policy);
+    sim->replacement = createReplacementPolicy(options.replacement, options.num_frames, references);
+    sim->swap = new SwapSpace(options.swap_path, options.page_size);
+    sim->page_table = new PageTable(options.page_size, sim->frames, sim->tlb, sim->replacement, sim->swap);
+    if (options.large_pages)
+    {
+        sim->page_table->enableLargePages();
+    }
+    sim->stats = new StatsEngine(sim->mmu, sim->page_table, sim->frames);
+    sim->stats_every = 0;
+    sim->merge_every = options.merge_every;
+    sim->page_size = options.page_size;
+    sim->quiet = false;
+    sim->out = &std::cout;
+    sim->mmus.push_back(sim->mmu);
+    sim->page_tables.push_back(sim->page_table);
+    sim->tlbs.push_back(sim->tlb);
+    return sim;
+}
+
+void destroySimulator(Simulator *sim)
+{
+    delete sim->stats;
+    delete sim->mmu;
+    delete sim->page_table;
+    delete sim->replacement;
+    delete sim->swap;
+    delete sim->tlb;
+    delete sim->frames;
+    delete sim;
+}
+
+ShardedSimulator* createShards(SimulatorOptions& options, const std::vector<uint64_t>& references, uint32_t num_shards)
+{
+    uint32_t i, j;
+    ShardedSimulator *sharded = new ShardedSimulator();
+    sharded->frames = new FrameAllocator(options.num_frames * options.page_size, options.page_size, options.memory_path);
+
+    //frames idle in caches are out of reach of the other shards, so small memories get small caches
+    uint32_t batch = std::max<uint32_t>(1, std::min<uint32_t>(SHARD_FRAME_BATCH, options.num_frames / (num_shards * 16)));
+
+    for (i = 0; i < num_shards; i++)
+    {
+        //each shard swaps to its own file and OPT only sees the references of its own pids
+        SimulatorOptions shard_options = options;
+        if (!options.swap_path.empty())
+        {
+            shard_options.swap_path = options.swap_path + "." + std::to_string(i);
+        }
+        std::vector<uint64_t> shard_references;
+        for (j = 0; j < references.size(); j++)
+        {
+            if ((references[j] >> 32) % num_shards == i)
+            {
+                shard_references.push_back(references[j]);
+            }
+        }
+
+        Simulator *sim = createSimulator(shard_options, shard_references, new FrameAllocator(sharded->frames, batch));
+        sharded->shards.push_back(sim);
+    }
+
+    //every shard can print the tables of all shards, it only does so while the others are idle
+    Simulator *first = sharded->shards[0];
+    for (i = 1; i < num_shards; i++)
+    {
+        first->mmus.push_back(sharded->shards[i]->mmu);
+        first->page_tables.push_back(sharded->shards[i]->page_table);
+        first->tlbs.push_back(sharded->shards[i]->tlb);
+    }
+    for (i = 0; i < num_shards; i++)
+    {
+        Simulator *sim = sharded->shards[i];
+        sim->mmus = first->mmus;
+        sim->page_tables = first->page_tables;
+        sim->tlbs = first->tlbs;
+        delete sim->stats;
+        sim->stats = new StatsEngine(sim->mmus, sim->page_tables, sim->frames);
+    }
+
+    sharded->next_pid = first->mmu->getNextPid();
+    sharded->pool = new ShardPool(num_shards, SHARD_WINDOW, runShardTask, sharded);
+    return sharded;
+}
+
+void destroyShards(ShardedSimulator *sharded)
+{
+    int i;
+    delete sharded->pool;
+    for (i = 0; i < sharded->shards.size(); i++)
+    {
+        destroySimulator(sharded->shards[i]);
+    }
+    delete sharded->frames;
+    delete sharded;
+}
+
+uint64_t runCommands(LineReader *trace, TraceReader *replay, TraceWriter *recorder, Simulator *sim, uint64_t flush_every)
+{
+    std::string command;
+    std::vector<std::string_view> command_list;
+    uint64_t num_commands = 0;
+    TraceRecord record;
+    while (replay != NULL && replay->next(&record)) {
+        num_commands++;
+        replayRecord(record, command_list, sim);
+
+        if(flush_every > 0 && num_commands % flush_every == 0){
+            fflush(stdout);
+        }
+        if(sim->merge_every > 0 && num_commands % sim->merge_every == 0){
+            sim->page_table->mergePages();
+        }
+        if(sim->stats->isRecording() && num_commands % sim->stats_every == 0){
+            sim->stats->sample(num_commands);
+        }
+    }
+    while (replay == NULL && nextCommand(trace, command)) {
+        if(recorder != NULL){
+            recorder->writeLine(command);
+        }
+
+        //command_list = Command + Arguments as views into command.... I.E. command_list[0] = create [1] = 1024 ... etc
+        tokenizeCommand(command, ' ', command_list);
+        if(command_list.empty()){
+            continue;
+        }
+
+        CommandType type = lookupCommand(command_list[0]);
+        if(type == CmdExit){
+            break;
+        }
+        num_commands++;
+        command_handlers[type](command_list, sim);
+
+        if(flush_every > 0 && num_commands % flush_every == 0){
+            fflush(stdout);
+        }
+        if(sim->merge_every > 0 && num_commands % sim->merge_every == 0){
+            sim->page_table->mergePages();
+        }
+        if(sim->stats->isRecording() && num_commands % sim->stats_every == 0){
+            sim->stats->sample(num_commands);
+        }
+    }
+
+    //the series always ends with the final state
+    if(sim->stats->isRecording() && num_commands % sim->stats_every != 0){
+        sim->stats->sample(num_commands);
+    }
+    return num_commands;
+}
+
+uint64_t runShardedCommands(LineReader *trace, TraceReader *replay, TraceWriter *recorder, ShardedSimulator *sharded, uint64_t flush_every)
+{
+    std::string command;
+    std::vector<std::string_view> command_list;
+    uint64_t num_commands = 0;
+    TraceRecord record;
+    ShardPool *pool = sharded->pool;
+    Simulator *first = sharded->shards[0];
+    uint32_t create_pid;
+    int shard;
+    while (replay != NULL && replay->next(&record)) {
+        num_commands++;
+        create_pid = 0;
+        if(record.opcode == TraceCreate){
+            create_pid = sharded->next_pid++;
+            shard = pool->shardOf(create_pid);
+        }
+        else if(record.opcode == TraceText){
+            tokenizeCommand(record.text, ' ', command_list);
+            shard = command_list.empty() ? 0 : routeCommand(lookupCommand(command_list[0]), command_list, sharded, &create_pid);
+        }
+        else{
+            shard = pool->shardOf(record.pid);
+        }
+
+        if(shard == SHARD_ALL){
+            synchronizeShards(sharded);
+            first->out = &std::cout;
+            replayRecord(record, command_list, first);
+        }
+        else{
+            //the reader reuses its value buffer for the next record, the task keeps a copy
+            ShardTask *task = pool->nextTask();
+            task->binary = true;
+            task->pid = create_pid;
+            task->record = record;
+            if(record.opcode == TraceSet){
+                const uint8_t *values = (const uint8_t*)record.values;
+                task->values.assign(values, values + record.count * dataTypeSize(record.type));
+            }
+            pool->submit(task, shard);
+        }
+
+        if(flush_every > 0 && num_commands % flush_every == 0){
+            fflush(stdout);
+        }
+        if(first->merge_every > 0 && num_commands % first->merge_every == 0){
+            mergeShards(sharded);
+        }
+        if(first->stats->isRecording() && num_commands % first->stats_every == 0){
+            synchronizeShards(sharded);
+            first->stats->sample(num_commands);
+        }
+    }
+    while (replay == NULL && nextCommand(trace, command)) {
+        if(recorder != NULL){
+            recorder->writeLine(command);
+        }
+
+        tokenizeCommand(command, ' ', command_list);
+        if(command_list.empty()){
+            continue;
+        }
+
+        CommandType type = lookupCommand(command_list[0]);
+        if(type == CmdExit){
+            break;
+        }
+        num_commands++;
+        shard = routeCommand(type, command_list, sharded, &create_pid);
+
+        if(shard == SHARD_ALL){
+            synchronizeShards(sharded);
+            first->out = &std::cout;
+            command_handlers[type](command_list, first);
+        }
+        else{
+            ShardTask *task = pool->nextTask();
+            task->command = command;
+            task->pid = create_pid;
+            pool->submit(task, shard);
+        }
+
+        if(flush_every > 0 && num_commands % flush_every == 0){
+            fflush(stdout);
+        }
+        if(first->merge_every > 0 && num_commands % first->merge_every == 0){
+            mergeShards(sharded);
+        }
+        if(first->stats->isRecording() && num_commands % first->stats_every == 0){
+            synchronizeShards(sharded);
+            first->stats->sample(num_commands);
+        }
+    }
+
+    synchronizeShards(sharded);
+    if(first->stats->isRecording() && num_commands % first->stats_every != 0){
+        first->stats->sample(num_commands);
+    }
+    return num_commands;
+}
+
+//Runs a merge pass in every shard, each merging only the pages of its own processes
+void mergeShards(ShardedSimulator *sharded)
+{
+    synchronizeShards(sharded);
+    for(uint32_t i = 0; i < sharded->shards.size(); i++){
+        sharded->shards[i]->page_table->mergePages();
+    }
+}
+
+//Runs one command on the worker thread of its shard
+void runShardTask(ShardTask *task, uint32_t shard, std::ostream& out, void *context)
+{
+    Simulator *sim = ((ShardedSimulator*)context)->shards[shard];
+    sim->out = &out;
+    if(task->pid != 0){
+        sim->mmu->setNextPid(task->pid);
+    }
+
+    if(task->binary){
+        task->record.values = task->values.data();
+        replayRecord(task->record, sim->args, sim);
+        return;
+    }
+    tokenizeCommand(task->command, ' ', sim->args);
+    command_handlers[lookupCommand(sim->args[0])](sim->args, sim);
+}
+
+//Shard that runs a command, SHARD_ALL for table prints. Commands that fail to parse
+//only print an error, so any shard will do.
+int routeCommand(CommandType type, std::vector<std::string_view>& args, ShardedSimulator *sharded, uint32_t *create_pid)
+{
+    uint32_t pid;
+    int text_size, data_size;
+    *create_pid = 0;
+
+    //a create with valid arguments takes the next pid even if it then runs out of memory
+    if(type == CmdCreate){
+        if(args.size() >= 3 && parseNumber(args[1], &text_size) && parseNumber(args[2], &data_size)){
+            *create_pid = sharded->next_pid++;
+            return sharded->pool->shardOf(*create_pid);
+        }
+        return 0;
+    }
+
+    //a fork takes the next pid even if there is no such parent
+    if(type == CmdFork){
+        if(args.size() >= 2 && parseNumber(args[1], &pid)){
+            *create_pid = sharded->next_pid++;
+            return sharded->pool->shardOf(pid);
+        }
+        return 0;
+    }
+
+    //<PID>:<var_name> belongs to its process, everything else prints across shards
+    if(type == CmdPrint){
+        if(args.size() < 2){
+            return 0;
+        }
+        size_t sepPosition = args[1].find(':');
+        if(sepPosition == std::string_view::npos){
+            return SHARD_ALL;
+        }
+        return parseNumber(args[1].substr(0, sepPosition), &pid) ? sharded->pool->shardOf(pid) : 0;
+    }
+
+    if(type != CmdUnknown && args.size() >= 2 && parseNumber(args[1], &pid)){
+        return sharded->pool->shardOf(pid);
+    }
+    return 0;
+}
+
+//Waits for every shard to go idle and returns cached frames, so counts across shards are exact
+void synchronizeShards(ShardedSimulator *sharded)
+{
+    int i;
+    sharded->pool->drain();
+    for (i = 0; i < sharded->shards.size(); i++)
+    {
+        sharded->shards[i]->frames->flushCache();
+    }
+}
+
+//Opens a trace file as a binary trace when it starts with the binary header, as text otherwise
+bool openCommands(std::string trace_path, LineReader **trace, TraceReader **replay)
+{
+    *trace = NULL;
+    *replay = NULL;
+    if (isBinaryTrace(trace_path))
+    {
+        *replay = new TraceReader();
+        if (!(*replay)->open(trace_path))
+        {
+            delete *replay;
+            *replay = NULL;
+            return false;
+        }
+        return true;
+    }
+
+    *trace = openTrace(trace_path);
+    return *trace != NULL;
+}
+
+//Runs the trace once without output, logging every page reference for OPT
+bool collectReferences(SimulatorOptions& options, std::string trace_path, std::vector<uint64_t>& references)
+{
+    LineReader *trace;
+    TraceReader *replay;
+    if (!openCommands(trace_path, &trace, &replay))
+    {
+        return false;
+    }
+
+    //the references are virtual, so any replacement policy and a private swap file do
+    SimulatorOptions pass_options = options;
+    pass_options.replacement = ReplaceFifo;
+    pass_options.swap_path = "";
+    std::vector<uint64_t> none;
+    Simulator *sim = createSimulator(pass_options, none, new FrameAllocator(options.num_frames * options.page_size, options.page_size));
+    sim->quiet = true;
+    sim->page_table->setReferenceLog(&references);
+
+    NullOutput null_output;
+    std::streambuf *console_output = std::cout.rdbuf(&null_output);
+    runCommands(trace, replay, NULL, sim, 0);
+    std::cout.rdbuf(console_output);
+    bool corrupt = replay != NULL && replay->isCorrupt();
+
+    destroySimulator(sim);
+    delete trace;
+    delete replay;
+    return !corrupt;
+}
+
+//Replays the trace with 1, 2, 4, ... up to max_threads threads, discarding the output,
+//and prints the throughput of each run. One thread is the plain single threaded simulator.
+bool runScaling(SimulatorOptions& options, std::string trace_path, const std::vector<uint64_t>& references, uint32_t max_threads)
+{
+    uint32_t threads = 1;
+    double single_seconds = 0.0;
+
+    printf(" Threads | Commands   | Seconds   | Commands/sec | Speedup\n");
+    printf("---------+------------+-----------+--------------+---------\n");
+    while (threads <= max_threads)
+    {
+        LineReader *trace;
+        TraceReader *replay;
+        if (!openCommands(trace_path, &trace, &replay))
+        {
+            return false;
+        }
+
+        Simulator *sim = NULL;
+        ShardedSimulator *sharded = NULL;
+        if (threads == 1)
+        {
+            sim = createSimulator(options, references, new FrameAllocator(options.num_frames * options.page_size, options.page_size));
+            sim->quiet = true;
+        }
+        else
+        {
+            sharded = createShards(options, references, threads);
+            for (int i = 0; i < sharded->shards.size(); i++)
+            {
+                sharded->shards[i]->quiet = true;
+            }
+        }
+
+        NullOutput null_output;
+        std::streambuf *console_output = std::cout.rdbuf(&null_output);
+        std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+        uint64_t num_commands = sharded != NULL ? runShardedCommands(trace, replay, NULL, sharded, 0)
+                                                : runCommands(trace, replay, NULL, sim, 0);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+        std::cout.rdbuf(console_output);
+
+        if (threads == 1)
+        {
+            single_seconds = seconds;
+        }
+        printf(" %7u | %10llu | %9.3f | %12.0f | %6.2fx\n", threads, (unsigned long long)num_commands, seconds,
+               seconds > 0 ? num_commands / seconds : 0.0, seconds > 0 ? single_seconds / seconds : 0.0);
+        fflush(stdout);
+        bool corrupt = replay != NULL && replay->isCorrupt();
+
+        if (sharded != NULL)
+        {
+            destroyShards(sharded);
+        }
+        else
+        {
+            destroySimulator(sim);
+        }
+        delete trace;
+        delete replay;
+        if (corrupt)
+        {
+            return false;
+        }
+
+        //doubling, but the last run always uses max_threads
+        if (threads < max_threads && threads * 2 > max_threads)
+        {
+            threads = max_threads;
+        }
+        else
+        {
+            threads *= 2;
+        }
+    }
+    return true;
+}
+
+void handleUnknown(std::vector<std::string_view>& args, Simulator *sim)
+{
+    *sim->out << "error: command not recognized" << std::endl;
+}
+
+void handleCreate(std::vector<std::string_view>& args, Simulator *sim)
+{
+    int textSize, dataSize;
+    if(args.size() < 3 || !parseNumber(args[1], &textSize) || !parseNumber(args[2], &dataSize)){
+        *sim->out << "error: invalid arguments" << std::endl;
+        return;
+    }
+    createProcess(textSize, dataSize, sim->mmu, sim->page_table, *sim->out);
+}
+
+void handleAllocate(std::vector<std::string_view>& args, Simulator *sim)
+{
+    uint32_t pid, numEl;
+    DataType dataType;
+    if(args.size() < 5 || !parseNumber(args[1], &pid) || !parseNumber(args[4], &numEl)){
+        *sim->out << "error: invalid arguments" << std::endl;
+        return;
+    }
+    if(!stringToDataType(args[3], &dataType)){
+        *sim->out << "error: datatype parameter not recognized" << std::endl;
+        return;
+    }
+
+    //optional align=<power of two>, on top of the type's natural alignment
+    uint32_t alignment = 1;
+    if(args.size() >= 6){
+        if(args[5].compare(0, 6, "align=") != 0 || !parseNumber(args[5].substr(6), &alignment) ||
+           alignment == 0 || (alignment & (alignment - 1)) != 0){
+            *sim->out << "error: invalid arguments" << std::endl;
+            return;
+        }
+    }
+
+    runAllocate(pid, args[2], dataType, numEl, alignment, sim);
+}
+
+//Parses args[first...] into consecutive elements of values, stopping at the first invalid one
+template <typename T>
+static uint32_t parseValues(std::vector<std::string_view>& args, size_t first, uint8_t *values)
+{
+    T value;
+    size_t i;
+    for(i = first; i < args.size(); i++){
+        if(!ElementTraits<T>::parse(args[i], &value)){
+            break;
+        }
+        ElementTraits<T>::store(values, value);
+        values += sizeof(T);
+    }
+    return i - first;
+}
+
+void handleSet(std::vector<std::string_view>& args, Simulator *sim)
+{
+    uint32_t pid, offset;
+    if(args.size() < 4 || !parseNumber(args[1], &pid) || !parseNumber(args[3], &offset)){
+        *sim->out << "error: invalid arguments" << std::endl;
+        return;
+    }
+
+    Variable var;
+    if(!findSetTarget(pid, args[2], sim, &var)){
+        return;
+    }
 
-    // Create physical 'memory'
-    uint32_t mem_size = 67108864;
-    void *memory = malloc(mem_size); // 64 MB (64 * 1024 * 1024)
+    //parse every value into the staging buffer, then copy them in one go
+    uint32_t count = args.size() - 4;
+    sim->values.resize(count * dataTypeSize(var.type));
+    uint32_t parsed = visitDataType(var.type, [&](auto tag) -> uint32_t {
+        return parseValues<typename decltype(tag)::type>(args, 4, sim->values.data());
+    });
 
-    // Create MMU and Page Table
-    Mmu *mmu = new Mmu(mem_size);
-    PageTable *page_table = new PageTable(page_size);
+    //the values before an invalid one are still set
+    setValues(pid, &var, offset, sim->values.data(), parsed, sim);
 
-    // Prompt loop
-    std::string command;
-    std::vector<std::string> command_list;
-    std::string lead_command;
-    std::cout << "> ";
-    std::getline (std::cin, command);
-    while (command != "exit") {
-        // Handle command
-        // TODO: implement this!
-
-        //command = current command
-        //command_list = Command + Arguments in Array format.... I.E. command_list[0] = create [1] = 1024 ... etc
-        splitString(command, ' ', command_list);
-        lead_command = command_list[0];
-        /*
-        std::cout << "command_list[0]: " << command_list[0] << std::endl;
-        std::cout << "command_list[1]: " << command_list[1] << std::endl;
-        std::cout << "command_list[2]: " << command_list[2] << std::endl;
-        std::cout << "lead_command: " << lead_command << std::endl;
-        */
-
-        //Valid Command Check
-        if(lead_command == "create"){
-
-            int textSize = stoi(command_list[1]);
-            int dataSize = stoi(command_list[2]); 
-            createProcess(textSize, dataSize, mmu, page_table);
-        }
-        else if(lead_command == "allocate"){
-
-            int pid = stoi(command_list[1]);
-            std::string varName = command_list[2];
-            DataType dataType = stringToDataType(command_list[3]);
-            int numEl = stoi(command_list[4]);
-            if(mmu->validProcess(pid) == false){
-                std::cout << "error: process not found" << std::endl;
-            }
-            else if(mmu->validVar(pid, varName) == true){
-                std::cout << "error: variable already exists" << std::endl;
-            }
-            else{
-                allocateVariable(pid, varName, dataType, numEl, mmu, page_table);
-            }
+    if(parsed < count){
+        *sim->out << "error: invalid value '" << args[4 + parsed] << "'" << std::endl;
+    }
+}
 
-        }
-        else if(lead_command == "set"){
-            //(uint32_t pid, std::string var_name, uint32_t offset, void *value, Mmu *mmu, PageTable *page_table, void *memory)
-            int i;
-            int pid = stoi(command_list[1]);
-            std::string varName = command_list[2];
-            uint32_t offset = stoul(command_list[3]);
-            if(mmu->validProcess(pid) == false){
-                std::cout << "error: process not found" << std::endl;
-            }
-            else if(mmu->validVar(pid, varName) == false){
-                std::cout << "error: variable not found" << std::endl;
-            }
-            else{
-                //std::cout << "Performing SET command" << std::endl;
-                DataType valueType = mmu->returnDatatype(pid, varName);
-
-                for(i = 4; i < command_list.size(); i++){
-                    if(valueType == Int){
-                        int value = stoi(command_list[i]);
-                        setVariable(pid, varName, (offset*4), &value, mmu, page_table, memory);
-                    }
-                    else if(valueType == Char){
-                        char value = command_list[i][0];
-                        setVariable(pid, varName, offset, &value, mmu, page_table, memory);
-                    }
-                    else if(valueType == Short){
-                        short value = (short)stoi(command_list[i]);
-                        setVariable(pid, varName, (offset*2), &value, mmu, page_table, memory);
-                    }
-                    else if(valueType == Float){
-                        float value = stof(command_list[i]);
-                        setVariable(pid, varName, (offset*4), &value, mmu, page_table, memory);
-                    }
-                    else if(valueType == Long){
-                        long value = stol(command_list[i]);
-                        setVariable(pid, varName, (offset*8), &value, mmu, page_table, memory);
-                    }
-                    else if(valueType == Double){
-                        double value = stod(command_list[i]);
-                        setVariable(pid, varName, (offset*8), &value, mmu, page_table, memory);
-                    }
-                    offset++;
-                }
-            }
-            
-        }   
-        else if(lead_command == "free"){
-
-            int pid = stoi(command_list[1]);
-            std::string varName = command_list[2];
-            if(mmu->validProcess(pid) == false){
-                std::cout << "error: process not found" << std::endl;
-            }
-            else if(mmu->validVar(pid, varName) == false){
-                std::cout << "error: variable not found" << std::endl;
-            }
-            else{
-                freeVariable(pid, varName, mmu, page_table);
-            }
+void handleFree(std::vector<std::string_view>& args, Simulator *sim)
+{
+    uint32_t pid;
+    if(args.size() < 3 || !parseNumber(args[1], &pid)){
+        *sim->out << "error: invalid arguments" << std::endl;
+        return;
+    }
 
-        }
-        else if(lead_command == "terminate"){
-        
-            int pid = stoi(command_list[1]);
-            if(mmu->validProcess(pid)){
-                terminateProcess(pid, mmu, page_table);
-            }
-            else{
-                std::cout << "error: process not found" << std::endl;
-            }
-        }
-        else if(lead_command == "print"){
+    runFree(pid, args[2], sim);
+}
 
-            std::string whatToPrint = command_list[1];
-            if(whatToPrint == "mmu"){
-                mmu->print();
-            }
-            else if(whatToPrint == "page"){
-                page_table->print();
-            }
-            else if(whatToPrint == "processes"){
-                page_table->printProcesses();
-            }
+void handleTerminate(std::vector<std::string_view>& args, Simulator *sim)
+{
+    uint32_t pid;
+    if(args.size() < 2 || !parseNumber(args[1], &pid)){
+        *sim->out << "error: invalid arguments" << std::endl;
+        return;
+    }
 
-            //<PID>:<var_name>
-            else{
-                std::string separator = ":";
-                size_t sepPosition = command_list[1].find(separator);
-                int PID = stoi(command_list[1].substr(0, sepPosition));
-                std::string varName = (command_list[1].substr(sepPosition + 1));
-
-                std::cout << "PID: " << PID << " varName: " << varName << std::endl;
-
-                std::vector<Process*> processes = mmu->getProcesses();
-                DataType varDataType = mmu->returnDatatype(PID, varName);
-                int i,j,k,physicalLoc;
-                uint32_t size,offsetNum;
-                physicalLoc = page_table->getPhysicalAddress(PID, mmu->getAddress(PID, varName));
-
-                offsetNum = 0;
-                for(i = 0; i < processes.size(); i++){
-                    if(processes[i]->pid == PID){
-                        for(j = 0; j < processes[i]->variables.size(); j++){
-                            if(processes[i]->variables[j]->name == varName){
-                                for(k = 0; k < 4; k++){
-                                    if(varDataType == Char){
-                                        //n = 1
-                                        size = processes[i]->variables[j]->size;
-                                        if(k == size - 1  && size <= 4){
-                                            char *memLoc = (char*)(memory) + physicalLoc + offsetNum;
-                                            std::cout << *memLoc;
-                                            break;
-                                        }
-                                        else{
-                                            char *memLoc = (char*)(memory) + physicalLoc + offsetNum;
-                                            std::cout << *memLoc << ", ";
-                                        }
-                                        offsetNum += 1;
-                                    }
-                                    else if(varDataType == Short){
-                                        //n =  2;
-                                        size = processes[i]->variables[j]->size/2;
-                                        if(k == size - 1  && size <= 4){
-                                            short *memLoc = (short*)(memory) + physicalLoc + offsetNum;
-                                            std::cout << *memLoc;
-                                            break;
-                                        }
-                                        else{
-                                            short *memLoc = (short*)(memory) + physicalLoc + offsetNum;
-                                            std::cout << *memLoc << ", ";
-                                        }
-                                        offsetNum += 2;
-                                    }
-                                    else if(varDataType == Float){
-                                        //n =  4;
-                                        size = processes[i]->variables[j]->size/4;
-                                        if(k == size - 1  && size <= 4){
-                                            float *memLoc = (float*)(memory) + physicalLoc + offsetNum;
-                                            std::cout << *memLoc;
-                                            break;
-                                        }
-                                        else{
-                                            float *memLoc = (float*)(memory) + physicalLoc + offsetNum;
-                                            std::cout << *memLoc << ", ";
-                                        }
-                                        offsetNum += 4;
-                                    }
-                                    else if(varDataType == Int){
-                                        //n =  4;
-                                        size = processes[i]->variables[j]->size/4;
-                                        if(k == size - 1  && size <= 4){
-                                            int *memLoc = (int*)(memory) + physicalLoc + offsetNum;
-                                            std::cout << *memLoc;
-                                            break;
-                                        }
-                                        else{
-                                            int *memLoc = (int*)(memory) + physicalLoc + offsetNum;
-                                            std::cout << *memLoc << ", ";
-                                        }
-                                        offsetNum += 4;
-                                    }
-                                    else if(varDataType == Long){
-                                        //n = 8;
-                                        size = processes[i]->variables[j]->size/8;
-                                        if(k == size - 1  && size <= 4){
-                                            long *memLoc = (long*)(memory) + physicalLoc + offsetNum;
-                                            std::cout << *memLoc;
-                                            break;
-                                        }
-                                        else{
-                                            long *memLoc = (long*)(memory) + physicalLoc + offsetNum;
-                                            std::cout << *memLoc << ", ";
-                                        }
-                                        offsetNum += 8;
-                                    }
-                                    else if(varDataType == Double){
-                                        //n =  8;
-                                        size = processes[i]->variables[j]->size/8;
-                                        if(k == size - 1  && size <= 4){
-                                            double *memLoc = (double*)(memory) + physicalLoc + offsetNum;
-                                            std::cout << *memLoc;
-                                            break;
-                                        }
-                                        else{
-                                            double *memLoc = (double*)(memory) + physicalLoc + offsetNum;
-                                            std::cout << *memLoc << ", ";
-                                        }
-                                        offsetNum += 8;
-                                    }
-                                }
-                                if(size > 4){
-                                    std::cout << "... [" << size << " items]";
-                                }
-                                std::cout << std::endl;
-                            }
-                        }
-                    }
-                }
+    runTerminate(pid, sim);
+}
+
+void handleFork(std::vector<std::string_view>& args, Simulator *sim)
+{
+    uint32_t pid;
+    if(args.size() < 2 || !parseNumber(args[1], &pid)){
+        *sim->out << "error: invalid arguments" << std::endl;
+        return;
+    }
+
+    //parent and child would live on different shards, which share no page table
+    if(sim->mmus.size() > 1){
+        *sim->out << "error: fork requires --threads=1" << std::endl;
+        return;
+    }
+
+    forkProcess(pid, sim->mmu, sim->page_table, *sim->out);
+}
+
+void handleAttach(std::vector<std::string_view>& args, Simulator *sim)
+{
+    uint32_t pid;
+    uint32_t size = 0;
+    if(args.size() < 3 || !parseNumber(args[1], &pid) || (args.size() >= 4 && !parseNumber(args[3], &size))){
+        *sim->out << "error: invalid arguments" << std::endl;
+        return;
+    }
+
+    //a segment lives in one page table, and processes attaching to it may be on different shards
+    if(sim->mmus.size() > 1){
+        *sim->out << "error: attach requires --threads=1" << std::endl;
+        return;
+    }
+
+    sim->name.assign(args[2]);
+    if(sim->mmu->validProcess(pid) == false){
+        *sim->out << "error: process not found" << std::endl;
+    }
+    else if(sim->mmu->validVar(pid, sim->name) == true){
+        *sim->out << "error: variable already exists" << std::endl;
+    }
+    else{
+        attachSegment(pid, sim->name, size, sim->mmu, sim->page_table, *sim->out);
+    }
+}
+
+void handleSnapshot(std::vector<std::string_view>& args, Simulator *sim)
+{
+    if(args.size() < 2){
+        *sim->out << "error: invalid arguments" << std::endl;
+        return;
+    }
+
+    //shards share physical memory but each has its own processes
+    if(sim->mmus.size() > 1){
+        *sim->out << "error: snapshot requires --threads=1" << std::endl;
+        return;
+    }
+
+    if(!saveSnapshot(std::string(args[1]), sim->mmu, sim->page_table, sim->frames)){
+        *sim->out << "error: could not write snapshot '" << args[1] << "'" << std::endl;
+    }
+}
+
+void handleRestore(std::vector<std::string_view>& args, Simulator *sim)
+{
+    if(args.size() < 2){
+        *sim->out << "error: invalid arguments" << std::endl;
+        return;
+    }
+
+    if(sim->mmus.size() > 1){
+        *sim->out << "error: restore requires --threads=1" << std::endl;
+        return;
+    }
+
+    if(!restoreSnapshot(std::string(args[1]), sim->mmu, sim->page_table, sim->frames)){
+        *sim->out << "error: could not restore snapshot '" << args[1] << "'" << std::endl;
+    }
+}
+
+void handlePrint(std::vector<std::string_view>& args, Simulator *sim)
+{
+    if(args.size() < 2){
+        *sim->out << "error: invalid arguments" << std::endl;
+        return;
+    }
+
+    std::string_view whatToPrint = args[1];
+    bool isVariable = whatToPrint.find(':') != std::string_view::npos;
+    if(sim->quiet && !isVariable){
+        return;
+    }
+
+    if(whatToPrint == "mmu"){
+        Mmu::print(sim->mmus);
+    }
+    else if(whatToPrint == "page"){
+        PageTable::print(sim->page_tables);
+    }
+    else if(whatToPrint == "processes"){
+        PageTable::printProcesses(sim->page_tables);
+    }
+    else if(whatToPrint == "frames"){
+        sim->frames->print();
+    }
+    else if(whatToPrint == "tlb"){
+        Tlb::print(sim->tlbs, sim->page_size);
+    }
+    else if(whatToPrint == "policy"){
+        Mmu::printPolicy(sim->mmus);
+    }
+    else if(whatToPrint == "paging"){
+        PageTable::printPaging(sim->page_tables);
+    }
+    else if(whatToPrint == "stats"){
+        sim->stats->print();
+    }
+    else if(whatToPrint == "large"){
+        PageTable::printLargePages(sim->page_tables);
+    }
+    else if(whatToPrint == "sharing"){
+        PageTable::printSharing(sim->page_tables);
+    }
 
-           }
+    //<PID>:<var_name>
+    else{
+        uint32_t PID;
+        size_t sepPosition = whatToPrint.find(':');
+        if(sepPosition == std::string_view::npos || !parseNumber(whatToPrint.substr(0, sepPosition), &PID)){
+            *sim->out << "error: invalid arguments" << std::endl;
+            return;
         }
-        //Invalid Command
-        else{
-            std::cout << "error: command not recognized" << std::endl;
+        std::string_view varName = whatToPrint.substr(sepPosition + 1);
+
+        *sim->out << "PID: " << PID << " varName: " << varName << std::endl;
+
+        sim->name.assign(varName);
+        Variable var;
+        if(sim->mmu->getVariable(PID, sim->name, &var)){
+            printVariable(PID, &var, sim->page_table, *sim->out);
         }
+    }
+}
 
-        // Get next command
-        std::cout << "> ";
-        std::getline (std::cin, command);
+void runAllocate(uint32_t pid, std::string_view var_name, DataType type, uint32_t num_elements, uint32_t alignment, Simulator *sim)
+{
+    sim->name.assign(var_name);
+    if(sim->mmu->validProcess(pid) == false){
+        *sim->out << "error: process not found" << std::endl;
+    }
+    else if(sim->mmu->validVar(pid, sim->name) == true){
+        *sim->out << "error: variable already exists" << std::endl;
     }
+    else{
+        allocateVariable(pid, sim->name, type, num_elements, alignment, sim->mmu, sim->page_table, *sim->out);
+    }
+}
 
-    // Cean up
-    free(memory);
-    delete mmu;
-    delete page_table;
+bool findSetTarget(uint32_t pid, std::string_view var_name, Simulator *sim, Variable *var)
+{
+    sim->name.assign(var_name);
+    bool found = sim->mmu->getVariable(pid, sim->name, var);
+    if(sim->mmu->validProcess(pid) == false){
+        *sim->out << "error: process not found" << std::endl;
+        return false;
+    }
+    else if(!found){
+        *sim->out << "error: variable not found" << std::endl;
+    }
+    return found;
+}
 
-    return 0;
+//values holds count already converted elements of var's type
+void setValues(uint32_t pid, Variable *var, uint32_t offset, const void *values, uint32_t count, Simulator *sim)
+{
+    uint32_t n = dataTypeSize(var->type);
+    uint32_t num_elements = var->size / n;
+    if(offset > num_elements || count > num_elements - offset){
+        *sim->out << "error: index out of range" << std::endl;
+        return;
+    }
+
+    //a write to a page shared with a forked process needs a frame for its copy
+    if(!sim->page_table->writeVirtual(pid, var->virtual_address + offset * n, values, count * n)){
+        *sim->out << "error: out of physical memory" << std::endl;
+    }
+}
+
+void runFree(uint32_t pid, std::string_view var_name, Simulator *sim)
+{
+    sim->name.assign(var_name);
+    Variable var;
+    bool found = sim->mmu->getVariable(pid, sim->name, &var);
+    if(sim->mmu->validProcess(pid) == false){
+        *sim->out << "error: process not found" << std::endl;
+    }
+    else if(!found){
+        *sim->out << "error: variable not found" << std::endl;
+    }
+    else{
+        freeVariable(pid, &var, sim->mmu, sim->page_table);
+    }
+}
+
+void runTerminate(uint32_t pid, Simulator *sim)
+{
+    if(sim->mmu->validProcess(pid)){
+        terminateProcess(pid, sim->mmu, sim->page_table);
+    }
+    else{
+        *sim->out << "error: process not found" << std::endl;
+    }
+}
+
+void replayRecord(TraceRecord& record, std::vector<std::string_view>& args, Simulator *sim)
+{
+    Variable var;
+    switch(record.opcode){
+        case TraceCreate:
+            createProcess((int)record.arg1, (int)record.arg2, sim->mmu, sim->page_table, *sim->out);
+            break;
+        case TraceAllocate:
+            runAllocate(record.pid, record.name, record.type, record.arg1, 1, sim);
+            break;
+        case TraceSet:
+            if(!findSetTarget(record.pid, record.name, sim, &var)){
+                break;
+            }
+            if(var.type != record.type){
+                *sim->out << "error: trace value type does not match variable" << std::endl;
+            }
+            else{
+                setValues(record.pid, &var, record.arg1, record.values, record.count, sim);
+            }
+            break;
+        case TraceFree:
+            runFree(record.pid, record.name, sim);
+            break;
+        case TraceTerminate:
+            runTerminate(record.pid, sim);
+            break;
+        default:
+            //TraceText: replay the original command line
+            tokenizeCommand(record.text, ' ', args);
+            if(!args.empty()){
+                command_handlers[lookupCommand(args[0])](args, sim);
+            }
+            break;
+    }
+}
+
+bool nextCommand(LineReader *trace, std::string& command)
+{
+    if (trace != NULL)
+    {
+        return trace->nextLine(command);
+    }
+
+    std::cout << "> ";
+    return (bool)std::getline(std::cin, command);
 }
 
 void printStartMessage(int page_size)
@@ -308,19 +1304,30 @@ void printStartMessage(int page_size)
     std::cout << "Welcome to the Memory Allocation Simulator! Using a page size of " << page_size << " bytes." << std:: endl;
     std::cout << "Commands:" << std:: endl;
     std::cout << "  * create <text_size> <data_size> (initializes a new process)" << std:: endl;
-    std::cout << "  * allocate <PID> <var_name> <data_type> <number_of_elements> (allocated memory on the heap)" << std:: endl;
+    std::cout << "  * allocate <PID> <var_name> <data_type> <number_of_elements> [align=N] (allocated memory on the heap)" << std:: endl;
     std::cout << "  * set <PID> <var_name> <offset> <value_0> <value_1> <value_2> ... <value_N> (set the value for a variable)" << std:: endl;
     std::cout << "  * free <PID> <var_name> (deallocate memory on the heap that is associated with <var_name>)" << std:: endl;
     std::cout << "  * terminate <PID> (kill the specified process)" << std:: endl;
+    std::cout << "  * fork <PID> (copy a process, sharing its pages until either process writes to them)" << std:: endl;
+    std::cout << "  * attach <PID> <segment> [<size>] (map a shared segment, created with <size> bytes by its first attach)" << std:: endl;
+    std::cout << "  * snapshot <file> (save every process and the contents of memory to <file>)" << std:: endl;
+    std::cout << "  * restore <file> (replace every process with those in a snapshot, memory is read in as it is used)" << std:: endl;
     std::cout << "  * print <object> (prints data)" << std:: endl;
     std::cout << "    * If <object> is \"mmu\", print the MMU memory table" << std:: endl;
     std::cout << "    * if <object> is \"page\", print the page table" << std:: endl;
     std::cout << "    * if <object> is \"processes\", print a list of PIDs for processes that are still running" << std:: endl;
+    std::cout << "    * if <object> is \"frames\", print the number of physical frames in use and free" << std:: endl;
+    std::cout << "    * if <object> is \"tlb\", print TLB hit/miss statistics" << std:: endl;
+    std::cout << "    * if <object> is \"policy\", print allocation policy throughput and fragmentation" << std:: endl;
+    std::cout << "    * if <object> is \"paging\", print page fault, first-touch fault, eviction and write-back counts" << std:: endl;
+    std::cout << "    * if <object> is \"stats\", print fragmentation, free hole sizes and resident pages per process" << std:: endl;
+    std::cout << "    * if <object> is \"large\", print large pages and the page table and TLB entries they save" << std:: endl;
+    std::cout << "    * if <object> is \"sharing\", print forks, shared segments, merged pages and the memory sharing saves" << std:: endl;
     std::cout << "    * if <object> is a \"<PID>:<var_name>\", print the value of the variable for that process" << std:: endl;
     std::cout << std::endl;
 }
 
-void createProcess(int text_size, int data_size, Mmu *mmu, PageTable *page_table)
+void createProcess(int text_size, int data_size, Mmu *mmu, PageTable *page_table, std::ostream& out)
 {
     //[1]: create new process in the MMU
     uint32_t PID = mmu->createProcess();
@@ -332,12 +1339,16 @@ void createProcess(int text_size, int data_size, Mmu *mmu, PageTable *page_table
     int space = 0;
     int i = 0;
 
-    mmu->addVariableToProcess(PID, "<TEXT>", Char, text_size, 0);
-    mmu->addVariableToProcess(PID, "<GLOBALS>", Char, data_size, text_size);
-    mmu->addVariableToProcess(PID, "<STACK>", Char, 65536, text_size + data_size);
+    mmu->addVariableToProcess(PID, "<TEXT>", Char, text_size, 0, 0, text_size);
+    mmu->addVariableToProcess(PID, "<GLOBALS>", Char, data_size, text_size, 0, data_size);
+    mmu->addVariableToProcess(PID, "<STACK>", Char, 65536, text_size + data_size, 0, 65536);
 
     while(space < tot_size){
-        page_table->addEntry(PID, i);
+        if(!page_table->addEntry(PID, i)){
+            out << "error: out of physical memory" << std::endl;
+            terminateProcess(PID, mmu, page_table);
+            return;
+        }
         i++;
         space += page_size;
     }
@@ -346,252 +1357,210 @@ void createProcess(int text_size, int data_size, Mmu *mmu, PageTable *page_table
     mmu->modifyFreeSpace(PID, tot_size, 0, 0);
 
     //[3]: print PID
-    std::cout << PID << std::endl;
+    out << PID << std::endl;
 }
 
-void allocateVariable(uint32_t pid, std::string var_name, DataType type, uint32_t num_elements, Mmu *mmu, PageTable *page_table)
+void allocateVariable(uint32_t pid, std::string var_name, DataType type, uint32_t num_elements, uint32_t alignment, Mmu *mmu, PageTable *page_table, std::ostream& out)
 {
 
     //Bytes per element of data
-    uint32_t n;
-    if(type == Char){
-        n = 1;
-    }
-    else if(type == Short){
-        n =  2;
-    }
-    else if(type == Int || type == Float){
-        n =  4;
-    }
-    else if(type == Long || type == Double){
-        n = 8;
-    }
-
-    //next unallocated page (also number of allocated pages)
-    int page = page_table->getNextPage(pid);
-    int page_size = page_table->getPageSize();
-    int allocatedSpace = page*page_size;
+    uint32_t n = dataTypeSize(type);
 
-    //[1]: find first free space within a page already allocated to this process that is large enough to fit the new variable
+    //variables are at least naturally aligned, so with power of two pages no element straddles a page boundary
+    alignment = std::max(alignment, dataTypeAlignment(type));
 
-    //Address of the first free space big enough for data size
-    uint32_t address = mmu->getFreeSpace(pid, n* num_elements, page_size * page);
+    int page_size = page_table->getPageSize();
 
-    if(address == -1)
+    //[1]: ask the allocation policy for a block big enough for the new variable
+    //the byte count of a huge array overflows 32 bits, and nothing bigger than the heap ever fits
+    uint64_t total_size = (uint64_t)n * num_elements;
+    if(total_size > UINT32_MAX || total_size > mmu->getMaxSize())
     {
+        out << "Allocation would exceed system memory" << std::endl;
         return;
     }
-
-    //regardless of allocated pages, check if an individual element crosses page boundries
-    int offset = adjustAddressForBoundry(address, n, num_elements, page_size);
-
-
-    while(address + offset + (n*num_elements) > allocatedSpace)
-    //[2]: if no hole is large enough, allocate new page(s)
+    uint32_t size = (uint32_t)total_size;
+    uint32_t block, reserved;
+    if(!mmu->allocateSpace(pid, size, 0, &block, &reserved))
     {
-        //add new page
-        page_table->addEntry(pid, page);
-        allocatedSpace += page_size;
-        page += 1;
+        out << "Allocation would exceed system memory" << std::endl;
+        return;
     }
 
-    //[3]: insert variable into MMU
-    mmu->modifyFreeSpace(pid, n*num_elements, address, offset);
-    mmu->addVariableToProcess(pid, var_name,type, n * num_elements, address + offset); 
+    //padding up to the next aligned address
+    uint32_t offset = (alignment - block % alignment) % alignment;
 
-    //[4]: print virtual memory address
-    std::cout << address + offset << std::endl;
-}
+    //if the padding pushes the variable past the end of its block, take a block with room for any padding
+    if(offset + size > reserved)
+    {
+        mmu->releaseSpace(pid, block, reserved, size);
+        if(!mmu->allocateSpace(pid, size, alignment - 1, &block, &reserved))
+        {
+            out << "Allocation would exceed system memory" << std::endl;
+            return;
+        }
+        offset = (alignment - block % alignment) % alignment;
+    }
+    uint32_t address = block + offset;
 
-uint32_t adjustAddressForBoundry(uint32_t address, uint32_t n, uint32_t num_elements, uint32_t page_size)
-{
-    for(int i = 0; i < num_elements; i++)
+    //[2]: map the pages the variable spans that are not mapped yet
+    uint32_t first_page = address / page_size;
+    uint32_t end_page = ((uint64_t)address + size + page_size - 1) / page_size;
+    for(uint32_t page = first_page; page < end_page; page++)
     {
-        int element_address = (i*n) + address;
-        for(int j = 1; j < n; j++)
+        //whole aligned blocks of pages go to a large page when there is a free run of frames
+        if(page % PT_LARGE_PAGES == 0 && end_page - page >= PT_LARGE_PAGES && page_table->addLargeEntry(pid, page))
         {
-            int check = element_address + j;
-            if(check%page_size == 0)
+            page += PT_LARGE_PAGES - 1;
+            continue;
+        }
+        if(!page_table->addEntry(pid, page))
+        {
+            //roll back the pages mapped for this variable, the ones no other variable uses
+            for(uint32_t i = first_page; i < page; i++)
             {
-                //page boundry exists inside of element, address will need to be offset by j bytes
-                return j;
+                if(mmu->isEmptyPage(pid, i))
+                {
+                    page_table->removeEntry(pid, i);
+                }
             }
+            mmu->releaseSpace(pid, block, reserved, size);
+            out << "error: out of physical memory" << std::endl;
+            return;
         }
     }
 
-    return 0;
+    //[3]: insert variable into MMU
+    mmu->addVariableToProcess(pid, var_name, type, size, address, offset, reserved);
+
+    //[4]: print virtual memory address
+    out << address << std::endl;
 }
 
-void setVariable(uint32_t pid, std::string var_name, uint32_t offset, void *value, Mmu *mmu, PageTable *page_table, void *memory)
+void printVariable(uint32_t pid, Variable *var, PageTable *page_table, std::ostream& out)
 {
-    // TODO: implement this!
-    //   - look up physical address for variable based on its virtual address / offset
-    //   - insert `value` into `memory` at physical address
-    //   * note: this function only handles a single element (i.e. you'll need to call this within a loop when setting
-    //           multiple elements of an array)
-
-    //[1]: Look up physical address
-    int physAddr = page_table->getPhysicalAddress(pid, mmu->getAddress(pid, var_name));
-
-    //[2]: Insert 'value' into 'memory' at physical address
-    DataType valueDataType = mmu->returnDatatype(pid, var_name);
-    int location = physAddr + offset;
-    if(valueDataType == Char){
-        //n = 1;
-        memcpy((char*)memory + location, value, 1);
-        char *memLoc = (char*)(memory) + physAddr + offset;
-        //std::cout << *memLoc;
-    }
-    else if(valueDataType == Short){
-        //n =  2;
-        memcpy((short*)memory + location, value, 2);
-        short *memLoc = (short*)(memory) + physAddr + offset;
-        //std::cout << *memLoc;
-    }
-    else if(valueDataType == Int || valueDataType == Float){
-        //n =  4;
-        if(valueDataType == Int){
-            memcpy((int*)memory + location, value, 4);
-            int *memLoc = (int*)(memory) + physAddr + offset;
-        }
-        else{
-            memcpy((float*)memory + location, value, 4);
-            float *memLoc = (float*)(memory) + physAddr + offset;
-            //std::cout << *memLoc;
-        }
+    //the first four elements are shown, followed by the item count for longer arrays
+    uint32_t n = dataTypeSize(var->type);
+    uint32_t size = var->size / n;
+    uint32_t shown = size < 4 ? size : 4;
+    uint64_t elements[4];
+    //the first read of a page never written needs a frame for it as well
+    if(!page_table->readVirtual(pid, var->virtual_address, elements, shown * n)){
+        out << "error: out of physical memory" << std::endl;
+        return;
     }
-    else if(valueDataType == Long || valueDataType == Double){
-        //n = 8;
-        if(valueDataType == Long){
-            memcpy((long*)memory + location, value, 8);
-            long *memLoc = (long*)(memory) + physAddr + offset;
-            //std::cout << *memLoc;
-        }
-        else{
-            memcpy((double*)memory + location, value, 8);
-            double *memLoc = (double*)(memory) + physAddr + offset;
-            //std::cout << *memLoc;
+
+    visitDataType(var->type, [&](auto tag) {
+        typedef typename decltype(tag)::type T;
+        for(uint32_t k = 0; k < shown; k++){
+            ElementTraits<T>::format(out, ElementTraits<T>::load((const char*)elements + k * sizeof(T)));
+            if(k != size - 1){
+                out << ", ";
+            }
         }
+    });
+    if(size > 4){
+        out << "... [" << size << " items]";
     }
-
+    out << std::endl;
 }
 
-void freeVariable(uint32_t pid, std::string var_name, Mmu *mmu, PageTable *page_table)
+void freeVariable(uint32_t pid, Variable *var, Mmu *mmu, PageTable *page_table)
 {
     //get size and address
-    uint32_t address = mmu->getAddress(pid, var_name);
-    uint32_t size = mmu->getSize(pid, var_name);
-    uint32_t pages = page_table->getNextPage(pid);
+    uint32_t address = var->virtual_address;
+    uint32_t size = var->size;
+    uint32_t block = address - var->padding;
+    uint32_t reserved = var->reserved;
     uint32_t page_size = page_table->getPageSize();
 
     //[1]: remove entry from MMU
-    mmu->removeVariableFromProcess(pid, address);
-
-    //edit freespace
-    mmu->restoreFreeSpace(pid, address, size);
+    mmu->removeVariableFromProcess(pid, var->name);
 
-    //[2]: free page if this variable was the only one on a given page
+    //return the variable's block to the allocation policy
+    mmu->releaseSpace(pid, block, reserved, size);
 
-    int index = 0;
-    int page = 0;
-    while (index < address)
-    {
-        index += page_size;
-        page++;
-    }
-    
-    for(page = page; page < pages; page++)
+    //[2]: free the pages of this variable that no other variable uses any more
+    uint32_t first_page = address / page_size;
+    uint32_t end_page = ((uint64_t)address + size + page_size - 1) / page_size;
+    for(uint32_t page = first_page; page < end_page; page++)
     {
-        if(mmu->isEmptyPage(pid, index, index + page_size))
+        if(mmu->isEmptyPage(pid, page))
         {
             page_table->removeEntry(pid, page);
         }
+    }
+}
+
+void forkProcess(uint32_t pid, Mmu *mmu, PageTable *page_table, std::ostream& out)
+{
+    //[1]: copy the process' variables and free space in the MMU
+    uint32_t child = mmu->forkProcess(pid);
+    if(child == 0){
+        out << "error: process not found" << std::endl;
+        return;
+    }
 
-        index += page_size;
+    //[2]: share the parent's pages with the child
+    if(!page_table->forkProcess(pid, child)){
+        out << "error: out of physical memory" << std::endl;
+        terminateProcess(child, mmu, page_table);
+        return;
     }
 
+    //[3]: print child PID
+    out << child << std::endl;
 }
 
-void terminateProcess(uint32_t pid, Mmu *mmu, PageTable *page_table)
+void attachSegment(uint32_t pid, std::string var_name, uint32_t size, Mmu *mmu, PageTable *page_table, std::ostream& out)
 {
+    int page_size = page_table->getPageSize();
 
-    //[1]: remove process from MMU
-    mmu->removeProcess(pid);
+    //[1]: a segment that exists keeps the size it was created with
+    if(!page_table->findSegment(var_name, &size) && size == 0){
+        out << "error: invalid arguments" << std::endl;
+        return;
+    }
 
-    //[2]: free all pages associated with given process
+    //[2]: take whole pages of the heap, no other variable may share a page with the segment
+    uint64_t span = ((uint64_t)size + page_size - 1) / page_size * page_size + page_size - 1;
+    uint32_t block, reserved;
+    if(span > UINT32_MAX || !mmu->allocateSpace(pid, size, span - size, &block, &reserved))
+    {
+        out << "Allocation would exceed system memory" << std::endl;
+        return;
+    }
+    uint32_t offset = (page_size - block % page_size) % page_size;
+    uint32_t address = block + offset;
 
-    uint32_t pages = page_table->getNextPage(pid);
-    
-    for(int i = 0; i < pages; i++)
+    //[3]: map the segment's frames
+    if(!page_table->attachSegment(pid, var_name, size, address / page_size))
     {
-        page_table->removeEntry(pid, i);
+        mmu->releaseSpace(pid, block, reserved, size);
+        out << "error: out of physical memory" << std::endl;
+        return;
     }
-}
 
-//--------------------------------------------------STRING METHODS--------------------------------------------------//
-//                                               (From Assignment #2)
+    //[4]: insert the segment as a char variable, so set and print work on it
+    mmu->addVariableToProcess(pid, var_name, Char, size, address, offset, reserved);
 
-/*
-   text: string to split
-   d: character delimiter to split `text` on
-   result: vector of strings - result will be stored here
-*/
-void splitString(std::string text, char d, std::vector<std::string>& result)
+    //[5]: print virtual memory address
+    out << address << std::endl;
+}
+
+void terminateProcess(uint32_t pid, Mmu *mmu, PageTable *page_table)
 {
-    enum states { NONE, IN_WORD, IN_STRING } state = NONE;
 
-    int i;
-    std::string token;
-    result.clear();
-    for (i = 0; i < text.length(); i++)
-    {
-        char c = text[i];
-        switch (state) {
-            case NONE:
-                if (c != d)
-                {
-                    if (c == '\"')
-                    {
-                        state = IN_STRING;
-                        token = "";
-                    }
-                    else
-                    {
-                        state = IN_WORD;
-                        token = c;
-                    }
-                }
-                break;
-            case IN_WORD:
-                if (c == d)
-                {
-                    result.push_back(token);
-                    state = NONE;
-                }
-                else
-                {
-                    token += c;
-                }
-                break;
-            case IN_STRING:
-                if (c == '\"')
-                {
-                    result.push_back(token);
-                    state = NONE;
-                }
-                else
-                {
-                    token += c;
-                }
-                break;
-        }
-    }
-    if (state != NONE)
-    {
-        result.push_back(token);
-    }
+    //[1]: remove process from MMU
+    mmu->removeProcess(pid);
+
+    //[2]: free all pages associated with given process
+    page_table->removeProcess(pid);
 }
 
+//--------------------------------------------------STRING METHODS--------------------------------------------------//
+//                                               (From Assignment #2)
+
 /*
    list: vector of strings to convert to an array of character arrays
    result: pointer to an array of character arrays when the vector of strings is copied to
@@ -625,29 +1594,3 @@ void freeArrayOfCharArrays(char **array, size_t array_length)
     }
     delete[] array;
 }
-
-DataType stringToDataType(std::string text){
-    DataType solution;
-    if(text == "Int" || text == "int"){
-        solution = Int;
-    }
-    else if(text == "Char" || text == "char"){
-        solution = Char;
-    }
-    else if(text == "Short" || text == "short"){
-        solution = Short;
-    }
-    else if(text == "Float" || text == "float"){
-        solution = Float;
-    }
-    else if(text == "Long" || text == "long"){
-        solution = Long;
-    }
-    else if(text == "Double" || text == "double"){
-        solution = Double;
-    }
-    else{
-        std::cout << "error: datatype parameter not recognized" << std::endl;
-    }
-    return solution;
-}
\ No newline at end of file
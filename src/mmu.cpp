@@ -1,363 +1,546 @@
+#include <chrono>
+#include <algorithm>
 #include "mmu.h"
 
-Mmu::Mmu(int memory_size)
+// processes per slab of the process pool
+#define PROCESS_SLAB_SIZE 64
+
+Mmu::Mmu(int memory_size, int page_size, AllocationPolicyType policy) : _process_pool(PROCESS_SLAB_SIZE)
 {
     _next_pid = 1024;
     _max_size = memory_size;
+    _page_size = page_size;
+    _policy_type = policy;
+    _policy_stats = AllocationStats();
+    _live_variable_bytes = 0;
+    _live_padding_bytes = 0;
 }
 
 Mmu::~Mmu()
 {
+    int i;
+    for (i = 0; i < _processes.size(); i++)
+    {
+        destroyProcess(_processes[i]);
+    }
+}
+
+//hands the arena of the process back in one piece, its variables and names included
+void Mmu::destroyProcess(Process *proc)
+{
+    proc->arena.releaseAll();
+    delete proc->policy;
+    _process_pool.destroy(proc);
 }
 
 uint32_t Mmu::createProcess()
 {
-    Process *proc = new Process();
+    Process *proc = _process_pool.create(&_chunks);
     proc->pid = _next_pid;
-
-    Variable *var = new Variable();
-    var->name = "<FREE_SPACE>";
-    var->type = DataType::FreeSpace;
-    var->virtual_address = 0;
-    var->size = _max_size;
-    proc->variables.push_back(var);
-
+    proc->free_space.release(0, _max_size);
+    proc->policy = createAllocationPolicy(_policy_type);
+    proc->live_requested_bytes = 0;
+    proc->live_reserved_bytes = 0;
+    proc->live_variable_bytes = 0;
+    proc->live_padding_bytes = 0;
+
+    proc->slot = _processes.size();
     _processes.push_back(proc);
+    _process_index[proc->pid] = proc;
 
     _next_pid++;
     return proc->pid;
 }
 
-void Mmu::addVariableToProcess(uint32_t pid, std::string var_name, DataType type, uint32_t size, uint32_t address)
+// The child starts with a copy of the variables, heap and policy state of
+// the parent; the page table shares the pages. The next pid is used up even
+// if there is no such parent, the way a create that runs out of memory
+// uses one, so a trace recorder can follow pids without running the trace.
+uint32_t Mmu::forkProcess(uint32_t pid)
 {
     int i;
-    Process *proc = NULL;
-    for (i = 0; i < _processes.size(); i++)
+    Variable var;
+    Process *parent = getProcess(pid);
+    if (parent == NULL)
+    {
+        _next_pid++;
+        return 0;
+    }
+
+    Process *proc = _process_pool.create(&_chunks);
+    proc->pid = _next_pid;
+    std::vector<std::pair<uint32_t, uint32_t> > extents = parent->free_space.getExtents();
+    for (i = 0; i < extents.size(); i++)
     {
-        if (_processes[i]->pid == pid)
+        proc->free_space.release(extents[i].first, extents[i].second);
+    }
+    proc->policy = parent->policy->clone();
+    proc->page_users = parent->page_users;
+    proc->live_requested_bytes = parent->live_requested_bytes;
+    proc->live_reserved_bytes = parent->live_reserved_bytes;
+    proc->live_variable_bytes = parent->live_variable_bytes;
+    proc->live_padding_bytes = parent->live_padding_bytes;
+
+    //names are interned again, the child's arena goes when the child does
+    for (i = 0; i < parent->variables.getRowCount(); i++)
+    {
+        if (parent->variables.getRow(i, &var))
         {
-            proc = _processes[i];
+            proc->variables.add(proc->arena.intern(var.name), var.type, var.virtual_address, var.size, var.padding, var.reserved);
         }
     }
 
-    Variable *var = new Variable();
-    var->name = var_name;
-    var->type = type;
-    var->virtual_address = address;
-    var->size = size;
-    if (proc != NULL)
+    _policy_stats.live_requested_bytes += proc->live_requested_bytes;
+    _policy_stats.live_reserved_bytes += proc->live_reserved_bytes;
+    _live_variable_bytes += proc->live_variable_bytes;
+    _live_padding_bytes += proc->live_padding_bytes;
+
+    proc->slot = _processes.size();
+    _processes.push_back(proc);
+    _process_index[proc->pid] = proc;
+
+    _next_pid++;
+    return proc->pid;
+}
+
+bool Mmu::addVariableToProcess(uint32_t pid, std::string var_name, DataType type, uint32_t size, uint32_t address, uint32_t padding, uint32_t reserved)
+{
+    Process *proc = getProcess(pid);
+    if (proc == NULL)
     {
-        proc->variables.push_back(var);
+        return false;
     }
+
+    proc->variables.add(proc->arena.intern(var_name), type, address, size, padding, reserved);
+    countPageUsers(proc, address, size, 1);
+
+    proc->live_variable_bytes += size;
+    proc->live_padding_bytes += padding;
+    _live_variable_bytes += size;
+    _live_padding_bytes += padding;
+
+    return true;
 }
 
-void Mmu::removeVariableFromProcess(uint32_t pid, uint32_t address)
+void Mmu::removeVariableFromProcess(uint32_t pid, std::string_view var_name)
 {
-    int i,j;
+    Variable var;
+    Process *proc = getProcess(pid);
+    if (proc == NULL || !proc->variables.remove(var_name, &var))
+    {
+        return;
+    }
 
-    for (i = 0; i < _processes.size(); i++)
+    proc->live_variable_bytes -= var.size;
+    proc->live_padding_bytes -= var.padding;
+    _live_variable_bytes -= var.size;
+    _live_padding_bytes -= var.padding;
+    proc->arena.releaseName(var.name);
+    countPageUsers(proc, var.virtual_address, var.size, -1);
+}
+
+//a variable uses the pages [address, address + size) overlaps, a zero sized one only the page it is strictly inside
+void Mmu::countPageUsers(Process *proc, uint32_t address, uint32_t size, int delta)
+{
+    uint32_t page;
+    uint32_t first = address / _page_size;
+    uint32_t end = ((uint64_t)address + size + _page_size - 1) / _page_size;
+    if (end > proc->page_users.size())
     {
-        //correct process
-        if(_processes[i]->pid == pid)
-        {
-            for (j = 0; j < _processes[i]->variables.size(); j++)
-            {
-                if(_processes[i]->variables[j]->virtual_address == address)
-                {
-                    _processes[i]->variables.erase(_processes[i]->variables.begin()+j);
-                }
-            }
-        }
+        proc->page_users.resize(end, 0);
+    }
+    for (page = first; page < end; page++)
+    {
+        proc->page_users[page] += delta;
     }
 }
 
 void Mmu::print()
+{
+    print(std::vector<Mmu*>(1, this));
+}
+
+//the processes of several shards are printed as one table ordered by pid
+void Mmu::print(const std::vector<Mmu*>& mmus)
 {
     int i, j, PID;
     std::string varName;
     uint32_t virAddr, varSize;
+    Variable var;
+
+    std::vector<Process*> processes;
+    for (i = 0; i < mmus.size(); i++)
+    {
+        processes.insert(processes.end(), mmus[i]->_processes.begin(), mmus[i]->_processes.end());
+    }
+    std::sort(processes.begin(), processes.end(), [](Process *a, Process *b) { return a->pid < b->pid; });
 
     std::cout << " PID  | Variable Name | Virtual Addr | Size" << std::endl;
     std::cout << "------+---------------+--------------+------------" << std::endl;
-    for (i = 0; i < _processes.size(); i++)
+    for (i = 0; i < processes.size(); i++)
     {
-        for (j = 0; j < _processes[i]->variables.size(); j++)
+        for (j = 0; j < processes[i]->variables.getRowCount(); j++)
         {
-            PID = _processes[i]->pid;
-            varName = _processes[i]->variables[j]->name;
-            virAddr = _processes[i]->variables[j]->virtual_address;
-            varSize = _processes[i]->variables[j]->size;
-
-            if(_processes[i]->variables[j]->type != DataType::FreeSpace)
+            if (!processes[i]->variables.getRow(j, &var))
             {
-                printf(" %4d | %-13s |  0x%08X  | %10u \n", PID, varName.c_str(), virAddr, varSize);
+                continue;
             }
+            PID = processes[i]->pid;
+            varName = var.name;
+            virAddr = var.virtual_address;
+            varSize = var.size;
+
+            printf(" %4d | %-13s |  0x%08X  | %10u \n", PID, varName.c_str(), virAddr, varSize);
         }
     }
 }
 
 void Mmu::removeProcess(uint32_t pid)
 {
-    int i, j;
-
-    for (i = 0; i < _processes.size(); i++)
+    Process *proc = getProcess(pid);
+    if (proc == NULL)
     {
-        //correct process
-        if(_processes[i]->pid == pid)
-        {
-            for (j = 0; j < _processes[i]->variables.size(); j++)
-            {
-                removeVariableFromProcess(pid, _processes[i]->variables[j]->virtual_address);
-                j--;//Super sketchy, but it doesn't seem to create an infinite loop
-            }
-        }
+        return;
     }
+
+    //the heap of a terminated process no longer counts as live
+    _policy_stats.live_requested_bytes -= proc->live_requested_bytes;
+    _policy_stats.live_reserved_bytes -= proc->live_reserved_bytes;
+    _live_variable_bytes -= proc->live_variable_bytes;
+    _live_padding_bytes -= proc->live_padding_bytes;
+
+    //the last process in the list takes over the slot, the list isn't kept in any order
+    Process *last = _processes.back();
+    _processes[proc->slot] = last;
+    last->slot = proc->slot;
+    _processes.pop_back();
+    _process_index.erase(pid);
+    destroyProcess(proc);
 }
 
 
-uint32_t Mmu::getFreeSpace(uint32_t pid, uint32_t size, u_int32_t allocatedSpace) 
+//slack asks the policy for extra bytes beyond size, e.g. room for alignment padding
+bool Mmu::allocateSpace(uint32_t pid, uint32_t size, uint32_t slack, uint32_t *address, uint32_t *reserved)
 {
-    int i, j;
+    Process *proc = getProcess(pid);
 
-    for (i = 0; i < _processes.size(); i++)
+    //pid not found
+    if (proc == NULL)
     {
-        //correct process
-        if(_processes[i]->pid == pid)
-        {
-            //starts at 1 as variable 0 is the main free space
-            for (j = 1; j < _processes[i]->variables.size(); j++)
-            {
-                //check for freespace
-                if(_processes[i]->variables[j]->type == DataType::FreeSpace && size <= _processes[i]->variables[j]->size)
-                {
-                    return _processes[i]->variables[j]->virtual_address;
-                } 
-            }
-            //return main free space address if no smaller free space fits
-            if(size <= _processes[i]->variables[0]->size)
-            {   
-                return _processes[i]->variables[0]->virtual_address;
-            } else {
-                std::cout << "Allocation would exceed system memory" << std::endl;
-                return -1;
-            }
-        }
+        return false;
     }
-    //pid not found
-    return -1;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    bool found = proc->policy->allocate(&proc->free_space, size + slack, address, reserved);
+    _policy_stats.elapsed_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+    if (!found)
+    {
+        _policy_stats.failures++;
+        return false;
+    }
+
+    _policy_stats.allocations++;
+    _policy_stats.requested_bytes += size;
+    _policy_stats.reserved_bytes += *reserved;
+    _policy_stats.live_requested_bytes += size;
+    _policy_stats.live_reserved_bytes += *reserved;
+    proc->live_requested_bytes += size;
+    proc->live_reserved_bytes += *reserved;
+    return true;
 }
 
-void Mmu::modifyFreeSpace(u_int32_t pid, uint32_t size, uint32_t address, uint32_t offset)
+void Mmu::releaseSpace(uint32_t pid, uint32_t address, uint32_t reserved, uint32_t size)
 {
-    int i,j;
+    Process *proc = getProcess(pid);
+    if (proc == NULL)
+    {
+        return;
+    }
 
-    for (i = 0; i < _processes.size(); i++)
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    proc->policy->release(&proc->free_space, address, reserved);
+    _policy_stats.elapsed_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+    _policy_stats.releases++;
+    _policy_stats.live_requested_bytes -= size;
+    _policy_stats.live_reserved_bytes -= reserved;
+    proc->live_requested_bytes -= size;
+    proc->live_reserved_bytes -= reserved;
+}
+
+void Mmu::modifyFreeSpace(u_int32_t pid, uint32_t size, uint32_t address, uint32_t offset)
+{
+    Process *proc = getProcess(pid);
+    if (proc == NULL)
     {
-        //correct process
-        if(_processes[i]->pid == pid)
-        {
-            for (j = 0; j < _processes[i]->variables.size(); j++)
-            {
-                if(_processes[i]->variables[j]->type == DataType::FreeSpace)
-                {
-                    if(_processes[i]->variables[j]->virtual_address == address)
-                    {
-                        Variable *free = _processes[i]->variables[j];
-
-                        //if the size of the free space was exactly equal to the size of the new variable, then it should be removed (no more free space)
-                        if(free->size == size)
-                        {
-                            removeVariableFromProcess(pid, address);
-                        }
-                        //If the size of the free space was larger than the size of the new variable, then the free space should be modified such that its
-                        //virtual address is N bytes bigger and its size should be N bytes less (where N is the size of the new variable)
-                        if(free->size > size)
-                        {
-                            free->virtual_address += size + offset;
-                            free->size -= size + offset;
-                        }
-                        //if offset was needed, create free space at address with size of offset
-                        if(offset > 0)
-                        {
-                            addVariableToProcess(pid, "<FREE_SPACE>", DataType::FreeSpace, offset, address);
-                        }
-                        return;
-                    }
-                }
-            }
-        }
+        return;
     }
+
+    //the variable takes [address + offset, address + offset + size), any offset bytes stay free
+    proc->free_space.reserve(address + offset, size);
 }
 
-void Mmu::restoreFreeSpace(uint32_t pid, uint32_t address, uint32_t size)
+void Mmu::printPolicy()
 {
-    int i,j, from, to;
+    printPolicy(std::vector<Mmu*>(1, this));
+}
 
-    from = address;
-    to = address + size;
+void Mmu::printPolicy(const std::vector<Mmu*>& mmus)
+{
+    int i, j;
+    uint64_t free_bytes = 0;
+    uint64_t largest_bytes = 0;
+    uint64_t holes = 0;
+    uint64_t padding_bytes = 0;
+    AllocationStats stats = AllocationStats();
 
-    //modify freespaces
-    for (i = 0; i < _processes.size(); i++)
+    for (i = 0; i < mmus.size(); i++)
     {
-        //correct process
-        if(_processes[i]->pid == pid)
+        const AllocationStats& shard = mmus[i]->_policy_stats;
+        stats.allocations += shard.allocations;
+        stats.failures += shard.failures;
+        stats.releases += shard.releases;
+        stats.requested_bytes += shard.requested_bytes;
+        stats.reserved_bytes += shard.reserved_bytes;
+        stats.live_requested_bytes += shard.live_requested_bytes;
+        stats.live_reserved_bytes += shard.live_reserved_bytes;
+        stats.elapsed_ns += shard.elapsed_ns;
+        padding_bytes += mmus[i]->_live_padding_bytes;
+
+        //external fragmentation: share of free memory that is not in the largest hole of its process
+        for (j = 0; j < mmus[i]->_processes.size(); j++)
         {
-            for (j = 1; j < _processes[i]->variables.size(); j++)
-            {
-                Variable *free = _processes[i]->variables[j];
-                //if this is a freespace before or after variable, remove and change to/from
-                if(free->type == DataType::FreeSpace)
-                {
-                    //if freespace comes after variable
-                    if(free->virtual_address == to)
-                    {
-                        to = free->virtual_address + free->size;
-                        removeVariableFromProcess(pid, free->virtual_address);
-                        j--;
-                    }
-
-                    //if freespace comes before variable
-                    if((free->virtual_address + free->size) == from)
-                    {
-                        from = free->virtual_address;
-                        removeVariableFromProcess(pid, free->virtual_address);
-                        j--;
-                    }
-                }
-            }
-            //if new free space is adjecent to the main free space, edit main free space
-            Variable *main_free = _processes[i]->variables[0];
-            if(main_free->virtual_address == to)
-            {
-                main_free->virtual_address = from;
-                main_free->size += to - from;
-                return;
-            }
+            Process *proc = mmus[i]->_processes[j];
+            free_bytes += proc->free_space.getTotalFree() + proc->policy->getHeldBytes();
+            largest_bytes += proc->free_space.getLargest();
+            holes += proc->free_space.getCount();
         }
     }
-    addVariableToProcess(pid, "<FREE_SPACE>", DataType::FreeSpace, to - from, from);
+
+    //shards run side by side, so this is throughput per shard
+    uint64_t operations = stats.allocations + stats.releases;
+    double seconds = stats.elapsed_ns / 1e9;
+    double internal = stats.live_reserved_bytes == 0 ? 0.0 :
+        100.0 * (stats.live_reserved_bytes - stats.live_requested_bytes) / stats.live_reserved_bytes;
+    double external = free_bytes == 0 ? 0.0 : 100.0 * (free_bytes - largest_bytes) / free_bytes;
+
+    printf("Policy:                 %s\n", allocationPolicyToString(mmus[0]->_policy_type).c_str());
+    printf("Allocations:            %llu (%llu failed)\n", (unsigned long long)stats.allocations, (unsigned long long)stats.failures);
+    printf("Releases:               %llu\n", (unsigned long long)stats.releases);
+    printf("Throughput:             %.0f ops/sec\n", seconds > 0 ? operations / seconds : 0.0);
+    printf("Bytes requested:        %llu\n", (unsigned long long)stats.requested_bytes);
+    printf("Bytes reserved:         %llu\n", (unsigned long long)stats.reserved_bytes);
+    printf("Internal fragmentation: %.2f%%\n", internal);
+    printf("Alignment padding:      %llu bytes\n", (unsigned long long)padding_bytes);
+    printf("External fragmentation: %.2f%% (%llu holes)\n", external, (unsigned long long)holes);
 }
 
-uint32_t Mmu::isEmptyPage(uint32_t pid, uint32_t from, uint32_t to)
+void Mmu::save(SnapshotWriter& out)
 {
-    int i,j;
-
+    int i, j;
+    Variable var;
+    out.putVarint(_next_pid);
+    out.putVarint(_policy_stats.allocations);
+    out.putVarint(_policy_stats.failures);
+    out.putVarint(_policy_stats.releases);
+    out.putVarint(_policy_stats.requested_bytes);
+    out.putVarint(_policy_stats.reserved_bytes);
+    out.putVarint(_policy_stats.elapsed_ns);
+
+    out.putVarint(_processes.size());
     for (i = 0; i < _processes.size(); i++)
     {
-        //correct process
-        if(_processes[i]->pid == pid)
+        Process *proc = _processes[i];
+        out.putVarint(proc->pid);
+        out.putVarint(proc->live_requested_bytes);
+        out.putVarint(proc->live_reserved_bytes);
+
+        uint32_t live_rows = 0;
+        for (j = 0; j < proc->variables.getRowCount(); j++)
         {
-            for (j = 0; j < _processes[i]->variables.size(); j++)
+            live_rows += proc->variables.getRow(j, &var) ? 1 : 0;
+        }
+        out.putVarint(live_rows);
+        for (j = 0; j < proc->variables.getRowCount(); j++)
+        {
+            if (!proc->variables.getRow(j, &var))
             {
-                if(_processes[i]->variables[j]->virtual_address >= from && _processes[i]->variables[j]->virtual_address < to)
-                {
-                    return false;
-                }
+                continue;
             }
+            out.putName(var.name);
+            out.putByte(var.type);
+            out.putVarint(var.virtual_address);
+            out.putVarint(var.size);
+            out.putVarint(var.padding);
+            out.putVarint(var.reserved);
+        }
+
+        std::vector<std::pair<uint32_t, uint32_t> > extents = proc->free_space.getExtents();
+        out.putVarint(extents.size());
+        for (j = 0; j < extents.size(); j++)
+        {
+            out.putVarint(extents[j].first);
+            out.putVarint(extents[j].second);
         }
+        proc->policy->save(out);
     }
-    return true;
 }
 
-uint32_t Mmu::getAddress(uint32_t pid, std::string var_name)
+//processes are added as they are read, so the caller can remove them all if the snapshot is cut short
+bool Mmu::load(SnapshotReader& in)
 {
-    int i,j;
+    uint32_t i, j, count, rows, extents;
+    if (!in.getVarint32(&_next_pid) || !in.getVarint(&_policy_stats.allocations) || !in.getVarint(&_policy_stats.failures)
+        || !in.getVarint(&_policy_stats.releases) || !in.getVarint(&_policy_stats.requested_bytes)
+        || !in.getVarint(&_policy_stats.reserved_bytes) || !in.getVarint(&_policy_stats.elapsed_ns) || !in.getVarint32(&count))
+    {
+        return false;
+    }
 
-    for (i = 0; i < _processes.size(); i++)
+    for (i = 0; i < count; i++)
     {
-        //correct process
-        if(_processes[i]->pid == pid)
+        uint32_t pid;
+        if (!in.getVarint32(&pid) || getProcess(pid) != NULL)
+        {
+            return false;
+        }
+        Process *proc = _process_pool.create(&_chunks);
+        proc->pid = pid;
+        proc->policy = createAllocationPolicy(_policy_type);
+        proc->live_variable_bytes = 0;
+        proc->live_padding_bytes = 0;
+        proc->slot = _processes.size();
+        _processes.push_back(proc);
+        _process_index[pid] = proc;
+
+        if (!in.getVarint(&proc->live_requested_bytes) || !in.getVarint(&proc->live_reserved_bytes) || !in.getVarint32(&rows))
         {
-            for (j = 0; j < _processes[i]->variables.size(); j++)
+            proc->live_requested_bytes = 0;
+            proc->live_reserved_bytes = 0;
+            return false;
+        }
+        _policy_stats.live_requested_bytes += proc->live_requested_bytes;
+        _policy_stats.live_reserved_bytes += proc->live_reserved_bytes;
+
+        for (j = 0; j < rows; j++)
+        {
+            std::string_view name;
+            uint8_t type;
+            uint32_t address, size, padding, reserved;
+            if (!in.getName(&name) || !in.getByte(&type) || type == FreeSpace || type >= NumDataTypes || !in.getVarint32(&address)
+                || !in.getVarint32(&size) || !in.getVarint32(&padding) || !in.getVarint32(&reserved))
             {
-                if(_processes[i]->variables[j]->name == var_name)
-                {
-                    return _processes[i]->variables[j]->virtual_address;
-                }
+                return false;
             }
+            addVariableToProcess(pid, std::string(name), (DataType)type, size, address, padding, reserved);
         }
-    }
-    return -1;
-}
 
-uint32_t Mmu::getSize(uint32_t pid, std::string var_name)
-{
-    int i,j;
-
-    for (i = 0; i < _processes.size(); i++)
-    {
-        //correct process
-        if(_processes[i]->pid == pid)
+        if (!in.getVarint32(&extents))
+        {
+            return false;
+        }
+        for (j = 0; j < extents; j++)
         {
-            for (j = 0; j < _processes[i]->variables.size(); j++)
+            uint32_t address, size;
+            if (!in.getVarint32(&address) || !in.getVarint32(&size))
             {
-                if(_processes[i]->variables[j]->name == var_name)
-                {
-                    return _processes[i]->variables[j]->size;
-                }
+                return false;
             }
+            proc->free_space.release(address, size);
+        }
+        if (!proc->policy->load(in))
+        {
+            return false;
         }
     }
-    return -1;
+    return true;
+}
+
+bool Mmu::isEmptyPage(uint32_t pid, uint32_t page)
+{
+    Process *proc = getProcess(pid);
+    return proc == NULL || page >= proc->page_users.size() || proc->page_users[page] == 0;
+}
+
+Process* Mmu::getProcess(uint32_t pid)
+{
+    std::unordered_map<uint32_t, Process*>::iterator it = _process_index.find(pid);
+    return (it == _process_index.end()) ? NULL : it->second;
+}
+
+bool Mmu::getVariable(uint32_t pid, const std::string& var_name, Variable *var)
+{
+    Process *proc = getProcess(pid);
+    return proc != NULL && proc->variables.find(var_name, var);
+}
+
+uint32_t Mmu::getAddress(uint32_t pid, std::string var_name)
+{
+    Variable var;
+    return getVariable(pid, var_name, &var) ? var.virtual_address : -1;
+}
+
+uint32_t Mmu::getSize(uint32_t pid, std::string var_name)
+{
+    Variable var;
+    return getVariable(pid, var_name, &var) ? var.size : -1;
 }
 
 bool Mmu::validProcess(uint32_t pid)
 {
-    int i;
-    bool solution = false;
-    for(i = 0; i < _processes.size(); i++)
-    {
-        if(_processes[i]->pid == pid)
-        {
-            solution = true;
-        }
-    }
-    return solution;
+    return getProcess(pid) != NULL;
 }
 
 bool Mmu::validVar(uint32_t pid, std::string var_name)
 {
-    int i,j;
-    bool solution = false;
-    for (i = 0; i < _processes.size(); i++)
-    {
-        //correct process
-        if(_processes[i]->pid == pid)
-        {
-            for (j = 0; j < _processes[i]->variables.size(); j++)
-            {
-                if(_processes[i]->variables[j]->name == var_name)
-                {
-                    solution = true;
-                }
-            }
-        }
-    }
-    return solution;
+    Variable var;
+    return getVariable(pid, var_name, &var);
 }
 
 DataType Mmu::returnDatatype(uint32_t pid, std::string var_name)
 {
-    int i,j;
-    DataType solution;
-    for (i = 0; i < _processes.size(); i++)
-    {
-        //correct process
-        if(_processes[i]->pid == pid)
-        {
-            for (j = 0; j < _processes[i]->variables.size(); j++)
-            {
-                if(_processes[i]->variables[j]->name == var_name)
-                {
-                    solution = _processes[i]->variables[j]->type;
-                }
-            }
-        }
-    }
-    return solution;
-} 
+    Variable var;
+    return getVariable(pid, var_name, &var) ? var.type : DataType::FreeSpace;
+}
 
 std::vector<Process*> Mmu::getProcesses()
 {
     return _processes;
-}
\ No newline at end of file
+}
+
+uint32_t Mmu::getNextPid()
+{
+    return _next_pid;
+}
+
+uint32_t Mmu::getMaxSize()
+{
+    return _max_size;
+}
+
+//shards share one pid space: the pid a process gets is decided before it reaches its shard
+void Mmu::setNextPid(uint32_t pid)
+{
+    _next_pid = pid;
+}
+
+const AllocationStats& Mmu::getPolicyStats()
+{
+    return _policy_stats;
+}
+
+uint64_t Mmu::getLiveVariableBytes()
+{
+    return _live_variable_bytes;
+}
+
+uint64_t Mmu::getLivePaddingBytes()
+{
+    return _live_padding_bytes;
+}
+
+AllocationPolicyType Mmu::getPolicyType()
+{
+    return _policy_type;
+}
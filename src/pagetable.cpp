@@ -1,143 +1,1858 @@
+#include <cstring>
+#include <thread>
 #include "pagetable.h"
 
-PageTable::PageTable(int page_size)
+PageTable::PageTable(int page_size, FrameAllocator *frames, Tlb *tlb, ReplacementPolicy *replacement, SwapSpace *swap)
 {
     _page_size = page_size;
+    _frames = frames;
+    _tlb = tlb;
+    _replacement = replacement;
+    _swap = swap;
+    _owners.resize(frames->getNumFrames());
+    _reference_log = NULL;
+    _faults = 0;
+    _evictions = 0;
+    _writebacks = 0;
+    _large_pages_enabled = false;
+    _large_pages = 0;
+    _pinned_pages = 0;
+    _untouched_pages = 0;
+    _first_touch_faults = 0;
+    _frame_refs.resize(frames->getNumFrames());
+    _shared_frames = 0;
+    _frames_saved = 0;
+    _forks = 0;
+    _cow_faults = 0;
+    _merge_passes = 0;
+    _merged_pages = 0;
+    _mapped_pages = 0;
+    _swapped_pages = 0;
+    _last_pid = 0;
+    _last_table = NULL;
+    _epochs = NULL;
+    _published = NULL;
 }
 
 PageTable::~PageTable()
 {
+    std::unordered_map<uint32_t, ProcessPageTable*>::iterator it;
+    for (it = _tables.begin(); it != _tables.end(); it++)
+    {
+        freeTable(it->second);
+    }
+
+    //releases whatever is still retired, the frames included
+    delete _epochs;
+    delete _published.load();
+}
+
+void PageTable::freeTable(ProcessPageTable *table)
+{
+    //readers still holding the table see a change in progress and look the pid up again
+    beginUpdate(table);
+    std::map<uint32_t, uint32_t>::iterator it;
+    for (it = table->ranges.begin(); it != table->ranges.end(); it++)
+    {
+        for (uint32_t page = it->first; page < it->second; page++)
+        {
+            releaseEntry(walk(table, page));
+        }
+    }
+
+    _large_pages -= table->large;
+
+    if (_epochs != NULL)
+    {
+        _epochs->retire([table] { deleteTable(table); });
+    }
+    else
+    {
+        deleteTable(table);
+    }
+}
+
+void PageTable::deleteTable(ProcessPageTable *table)
+{
+    for (int i = 0; i < PT_LEVEL_SIZE; i++)
+    {
+        PageTableMiddle *middle = table->middles[i];
+        if (middle == NULL)
+        {
+            continue;
+        }
+        for (int j = 0; j < PT_LEVEL_SIZE; j++)
+        {
+            delete middle->leaves[j];
+        }
+        delete middle;
+    }
+    delete table;
+}
+
+// Seqlock around a change to a mapping: readers that overlap it see an odd or
+// changed sequence number and walk again
+void PageTable::beginUpdate(ProcessPageTable *table)
+{
+    __atomic_store_n(&table->sequence, table->sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+void PageTable::endUpdate(ProcessPageTable *table)
+{
+    __atomic_store_n(&table->sequence, table->sequence + 1, __ATOMIC_RELEASE);
+}
+
+// Readers look pids up in a copy of _tables, replaced and retired as a whole
+// whenever a process table is added or removed
+void PageTable::publishTables()
+{
+    if (_epochs == NULL)
+    {
+        return;
+    }
+
+    ProcessTableIndex *old = _published.exchange(new ProcessTableIndex(_tables));
+    retireObject(old);
+}
+
+ProcessPageTable* PageTable::findTable(uint32_t pid)
+{
+    if (_last_table != NULL && _last_pid == pid)
+    {
+        return _last_table;
+    }
+
+    std::unordered_map<uint32_t, ProcessPageTable*>::iterator it = _tables.find(pid);
+    if (it == _tables.end())
+    {
+        return NULL;
+    }
+
+    _last_pid = pid;
+    _last_table = it->second;
+    return _last_table;
+}
+
+PageTableEntry* PageTable::findEntry(uint32_t pid, uint32_t page)
+{
+    if (page >= PT_MAX_PAGES)
+    {
+        return NULL;
+    }
+
+    ProcessPageTable *table = findTable(pid);
+    if (table == NULL)
+    {
+        return NULL;
+    }
+
+    PageTableEntry *entry = walk(table, page);
+    return (entry != NULL && (entry->flags & (PTE_PRESENT | PTE_SWAPPED | PTE_ZERO))) ? entry : NULL;
+}
+
+//slot of page in the tree of table, NULL if no leaf holds it
+PageTableEntry* PageTable::walk(ProcessPageTable *table, uint32_t page)
+{
+    PageTableMiddle *middle = table->middles[page >> (2 * PT_LEVEL_BITS)];
+    if (middle == NULL)
+    {
+        return NULL;
+    }
+
+    PageTableLeaf *leaf = middle->leaves[(page >> PT_LEVEL_BITS) & PT_LEVEL_MASK];
+    if (leaf == NULL)
+    {
+        return NULL;
+    }
+
+    return &leaf->entries[page & PT_LEVEL_MASK];
+}
+
+//runs stay maximal: a page joining two runs merges them
+void PageTable::addRange(ProcessPageTable *table, uint32_t page)
+{
+    std::map<uint32_t, uint32_t>::iterator next = table->ranges.upper_bound(page);
+    bool joins_next = next != table->ranges.end() && next->first == page + 1;
+    uint32_t end = joins_next ? next->second : page + 1;
+    if (joins_next)
+    {
+        table->ranges.erase(next++);
+    }
+
+    if (next != table->ranges.begin())
+    {
+        std::map<uint32_t, uint32_t>::iterator previous = std::prev(next);
+        if (previous->second == page)
+        {
+            previous->second = end;
+            return;
+        }
+    }
+    table->ranges.emplace_hint(next, page, end);
+}
+
+//removing a page from the middle of a run splits it in two
+void PageTable::removeRange(ProcessPageTable *table, uint32_t page)
+{
+    std::map<uint32_t, uint32_t>::iterator it = table->ranges.upper_bound(page);
+    if (it == table->ranges.begin())
+    {
+        return;
+    }
+
+    it--;
+    uint32_t first = it->first;
+    uint32_t end = it->second;
+    if (page >= end)
+    {
+        return;
+    }
+
+    table->ranges.erase(it);
+    if (first < page)
+    {
+        table->ranges.emplace(first, page);
+    }
+    if (page + 1 < end)
+    {
+        table->ranges.emplace(page + 1, end);
+    }
+}
+
+void PageTable::recordReference(uint32_t pid, uint32_t page)
+{
+    if (_reference_log != NULL)
+    {
+        _reference_log->push_back(((uint64_t)pid << 32) | page);
+    }
+}
+
+// Reference to a resident page. Pinned pages are not the replacement
+// policy's to track, so they stay out of the reference log as well and the
+// log OPT plans with lines up with the references the policy sees.
+void PageTable::touchFrame(uint32_t pid, uint32_t page, uint32_t frame, bool pinned)
+{
+    if (pinned)
+    {
+        return;
+    }
+    if (_replacement != NULL)
+    {
+        _replacement->frameAccessed(frame);
+    }
+    recordReference(pid, page);
+}
+
+int PageTable::obtainFrame()
+{
+    int frame = _frames->allocate();
+    if (frame >= 0 || _replacement == NULL || _swap == NULL)
+    {
+        return frame;
+    }
+
+    //a page table sharing memory with others may find it full while holding no frame it could evict
+    if (_mapped_pages == _swapped_pages + _pinned_pages + _untouched_pages)
+    {
+        return -1;
+    }
+
+    //memory is full: evict the page the replacement policy picks and reuse its frame
+    uint32_t victim = _replacement->selectVictim();
+    FrameOwner *owner = &_owners[victim];
+    PageTableEntry *entry = owner->entry;
+
+    //a clean page that still has its copy in swap is dropped without writing it back
+    if (owner->swap_slot < 0 || (entry->flags & PTE_DIRTY))
+    {
+        int slot = owner->swap_slot < 0 ? _swap->allocate() : owner->swap_slot;
+        if (!_swap->write(slot, (char*)_frames->getMemory() + (size_t)victim * _page_size))
+        {
+            if (owner->swap_slot < 0)
+            {
+                _swap->release(slot);
+            }
+            return -1;
+        }
+        owner->swap_slot = slot;
+        _writebacks++;
+    }
+
+    _replacement->frameReleased(victim);
+    if (_tlb != NULL)
+    {
+        _tlb->invalidate(owner->pid, owner->page);
+    }
+    ProcessPageTable *table = findTable(owner->pid);
+    beginUpdate(table);
+    storeEntry(entry, owner->swap_slot, PTE_SWAPPED);
+    endUpdate(table);
+    owner->entry = NULL;
+    table->resident--;
+    _swapped_pages++;
+    _evictions++;
+
+    return victim;
+}
+
+void PageTable::loadFrame(uint32_t pid, uint32_t page, PageTableEntry *entry, uint32_t frame, int swap_slot)
+{
+    storeEntry(entry, frame, PTE_PRESENT);
+
+    FrameOwner *owner = &_owners[frame];
+    owner->pid = pid;
+    owner->page = page;
+    owner->entry = entry;
+    owner->swap_slot = swap_slot;
+
+    if (_replacement != NULL)
+    {
+        _replacement->frameLoaded(frame);
+    }
+    recordReference(pid, page);
+}
+
+//page fault: read the page back from swap into a free (or freshly evicted) frame
+bool PageTable::pageIn(uint32_t pid, uint32_t page, PageTableEntry *entry)
+{
+    uint32_t slot = entry->frame;
+    int new_frame = obtainFrame();
+    if (new_frame < 0)
+    {
+        return false;
+    }
+    if (!_swap->read(slot, (char*)_frames->getMemory() + (size_t)new_frame * _page_size))
+    {
+        _frames->release(new_frame);
+        return false;
+    }
+    _faults++;
+    _swapped_pages--;
+    ProcessPageTable *table = findTable(pid);
+    table->resident++;
+    beginUpdate(table);
+    loadFrame(pid, page, entry, new_frame, slot);
+    endUpdate(table);
+    return true;
+}
+
+//first touch of a reserved page: bind it to a frame and fill that with zeros
+bool PageTable::touchZeroPage(uint32_t pid, uint32_t page, PageTableEntry *entry)
+{
+    int frame = obtainFrame();
+    if (frame < 0)
+    {
+        return false;
+    }
+    memset((char*)_frames->getMemory() + (size_t)frame * _page_size, 0, _page_size);
+    _first_touch_faults++;
+    _untouched_pages--;
+    ProcessPageTable *table = findTable(pid);
+    table->resident++;
+    beginUpdate(table);
+    loadFrame(pid, page, entry, frame, -1);
+    endUpdate(table);
+    return true;
+}
+
+//hands back a frame no page maps any more, along with its copy in swap
+void PageTable::freeFrame(uint32_t frame)
+{
+    FrameOwner *owner = &_owners[frame];
+    if (owner->swap_slot >= 0)
+    {
+        _swap->release(owner->swap_slot);
+        owner->swap_slot = -1;
+    }
+    owner->entry = NULL;
+
+    //with concurrent readers the frame is only reused once no reader can still be copying from it
+    if (_epochs != NULL)
+    {
+        _epochs->retire([this, frame] {
+            //poisoned first, so a reader still using the mapping shows up as garbage
+            memset((char*)_frames->getMemory() + (size_t)frame * _page_size, 0xA5, _page_size);
+            _frames->release(frame);
+        });
+    }
+    else
+    {
+        _frames->release(frame);
+    }
+}
+
+void PageTable::releaseEntry(PageTableEntry *entry)
+{
+    //unmapped before the frame is handed back, so readers cannot find it again
+    uint32_t flags = entry->flags;
+    uint32_t frame = entry->frame;
+    storeEntry(entry, frame, 0);
+
+    if (flags & PTE_PRESENT)
+    {
+        //a shared frame stays with the processes that still map it
+        if (flags & (PTE_COW | PTE_SHARED))
+        {
+            dropSharer(frame, entry);
+            return;
+        }
+        if (flags & PTE_LARGE)
+        {
+            _pinned_pages--;
+        }
+        else if (_replacement != NULL)
+        {
+            _replacement->frameReleased(frame);
+        }
+        freeFrame(frame);
+    }
+    else if (flags & PTE_SWAPPED)
+    {
+        _swap->release(frame);
+        _swapped_pages--;
+    }
+    else if (flags & PTE_ZERO)
+    {
+        _untouched_pages--;
+    }
+}
+
+std::vector<uint32_t> PageTable::sortedPids()
+{
+    std::vector<uint32_t> pids;
+
+    std::unordered_map<uint32_t, ProcessPageTable*>::iterator it;
+    for (it = _tables.begin(); it != _tables.end(); it++)
+    {
+        pids.push_back(it->first);
+    }
+
+    std::sort(pids.begin(), pids.end());
+
+    return pids;
+}
+
+// Reserves a base page for pid. No frame is taken until the page is first
+// read or written, so only memory a process uses counts as resident.
+bool PageTable::addEntry(uint32_t pid, int page_number)
+{
+    uint32_t page = page_number;
+    if (page_number < 0 || page >= PT_MAX_PAGES)
+    {
+        return false;
+    }
+
+    if (findEntry(pid, page) != NULL)
+    {
+        return true;
+    }
+
+    ProcessPageTable *table;
+    PageTableLeaf *leaf = createLeaf(pid, page, &table);
+    PageTableEntry *entry = &leaf->entries[page & PT_LEVEL_MASK];
+    beginUpdate(table);
+    storeEntry(entry, 0, PTE_ZERO);
+    endUpdate(table);
+    addRange(table, page);
+    leaf->used++;
+    table->mapped++;
+    _mapped_pages++;
+    _untouched_pages++;
+    return true;
+}
+
+//leaf holding page, with the process table and levels above it created as needed
+PageTableLeaf* PageTable::createLeaf(uint32_t pid, uint32_t page, ProcessPageTable **table)
+{
+    *table = findTable(pid);
+    if (*table == NULL)
+    {
+        *table = new ProcessPageTable();
+        _tables[pid] = *table;
+        _last_pid = pid;
+        _last_table = *table;
+        publishTables();
+    }
+
+    //new levels are filled in before readers can reach them
+    PageTableMiddle *&middle = (*table)->middles[page >> (2 * PT_LEVEL_BITS)];
+    if (middle == NULL)
+    {
+        __atomic_store_n(&middle, new PageTableMiddle(), __ATOMIC_RELEASE);
+        (*table)->used++;
+    }
+
+    PageTableLeaf *&leaf = middle->leaves[(page >> PT_LEVEL_BITS) & PT_LEVEL_MASK];
+    if (leaf == NULL)
+    {
+        __atomic_store_n(&leaf, new PageTableLeaf(), __ATOMIC_RELEASE);
+        middle->used++;
+    }
+    return leaf;
+}
+
+void PageTable::enableLargePages()
+{
+    _large_pages_enabled = true;
+}
+
+bool PageTable::largePagesEnabled()
+{
+    return _large_pages_enabled;
+}
+
+// Maps the PT_LARGE_PAGES pages from first_page, which has to be aligned to
+// them with none of them mapped, to one run of frames. Large pages are not
+// handed to the replacement policy, so they are never evicted. Returns false
+// if there is no free run; the caller then maps base pages instead.
+bool PageTable::addLargeEntry(uint32_t pid, uint32_t first_page)
+{
+    uint32_t i;
+    if (!_large_pages_enabled || first_page % PT_LARGE_PAGES != 0 || first_page >= PT_MAX_PAGES)
+    {
+        return false;
+    }
+
+    //the leaf only exists while one of its pages is mapped
+    ProcessPageTable *table = findTable(pid);
+    PageTableMiddle *middle = (table == NULL) ? NULL : table->middles[first_page >> (2 * PT_LEVEL_BITS)];
+    if (middle != NULL && middle->leaves[(first_page >> PT_LEVEL_BITS) & PT_LEVEL_MASK] != NULL)
+    {
+        return false;
+    }
+
+    int first_frame = _frames->allocateRun(PT_LARGE_PAGES);
+    if (first_frame < 0)
+    {
+        return false;
+    }
+
+    PageTableLeaf *leaf = createLeaf(pid, first_page, &table);
+    beginUpdate(table);
+    for (i = 0; i < PT_LARGE_PAGES; i++)
+    {
+        FrameOwner *owner = &_owners[first_frame + i];
+        storeEntry(&leaf->entries[i], first_frame + i, PTE_PRESENT | PTE_LARGE);
+        owner->pid = pid;
+        owner->page = first_page + i;
+        owner->entry = &leaf->entries[i];
+        owner->swap_slot = -1;
+        addRange(table, first_page + i);
+    }
+    endUpdate(table);
+
+    leaf->used = PT_LARGE_PAGES;
+    table->mapped += PT_LARGE_PAGES;
+    table->resident += PT_LARGE_PAGES;
+    table->large++;
+    _mapped_pages += PT_LARGE_PAGES;
+    _pinned_pages += PT_LARGE_PAGES;
+    _large_pages++;
+    return true;
+}
+
+// Splits the large page at first_page into base pages that are evicted and
+// released one by one like any other
+void PageTable::demote(uint32_t pid, ProcessPageTable *table, uint32_t first_page)
+{
+    uint32_t i;
+    PageTableLeaf *leaf = table->middles[first_page >> (2 * PT_LEVEL_BITS)]->leaves[(first_page >> PT_LEVEL_BITS) & PT_LEVEL_MASK];
+    if (_tlb != NULL)
+    {
+        _tlb->invalidate(pid, first_page);
+    }
+
+    beginUpdate(table);
+    for (i = 0; i < PT_LARGE_PAGES; i++)
+    {
+        PageTableEntry *entry = &leaf->entries[i];
+        storeEntry(entry, entry->frame, entry->flags & ~PTE_LARGE);
+        if (_replacement != NULL)
+        {
+            _replacement->frameLoaded(entry->frame);
+        }
+        recordReference(pid, first_page + i);
+    }
+    endUpdate(table);
+
+    table->large--;
+    _pinned_pages -= PT_LARGE_PAGES;
+    _large_pages--;
+}
+
+bool PageTable::isLargeFrame(uint32_t frame)
+{
+    return _large_pages != 0 && (_owners[frame].entry->flags & PTE_LARGE);
+}
+
+bool PageTable::isSharedFrame(uint32_t frame)
+{
+    return _shared_frames != 0 && _frame_refs[frame] != 0;
+}
+
+// Maps every page of parent into child as well, read only on both sides, so
+// the two share frames until one of them writes. Swapped out pages are read
+// back in first and large pages are split, since only resident base pages
+// are shared; pages never touched are just reserved in the child as well.
+// Returns false, with no child pages left, if memory runs out.
+bool PageTable::forkProcess(uint32_t parent, uint32_t child)
+{
+    ProcessPageTable *table = findTable(parent);
+    if (table == NULL)
+    {
+        return true;
+    }
+
+    std::map<uint32_t, uint32_t>::iterator it;
+    for (it = table->ranges.begin(); it != table->ranges.end(); it++)
+    {
+        for (uint32_t page = it->first; page < it->second; page++)
+        {
+            PageTableEntry *entry = walk(table, page);
+            if (entry->flags & PTE_LARGE)
+            {
+                demote(parent, table, page - page % PT_LARGE_PAGES);
+            }
+            if (entry->flags & PTE_ZERO)
+            {
+                addEntry(child, page);
+                continue;
+            }
+            if (!(entry->flags & PTE_PRESENT) && !pageIn(parent, page, entry))
+            {
+                removeProcess(child);
+                return false;
+            }
+
+            //segment pages stay writable by both, every other page is copied on write
+            uint32_t frame = entry->frame;
+            if (_frame_refs[frame] == 0)
+            {
+                shareFrame(frame);
+            }
+
+            ProcessPageTable *child_table;
+            PageTableLeaf *leaf = createLeaf(child, page, &child_table);
+            PageTableEntry *child_entry = &leaf->entries[page & PT_LEVEL_MASK];
+            addSharer(frame, child, page, child_entry);
+            beginUpdate(child_table);
+            storeEntry(child_entry, frame, PTE_PRESENT | (entry->flags & (PTE_COW | PTE_SHARED | PTE_DIRTY)));
+            endUpdate(child_table);
+            addRange(child_table, page);
+            leaf->used++;
+            child_table->mapped++;
+            child_table->resident++;
+            _mapped_pages++;
+        }
+    }
+
+    _forks++;
+    return true;
+}
+
+// First write to a shared frame: the writer gets a copy of its own
+bool PageTable::copyOnWrite(uint32_t pid, uint32_t page, PageTableEntry *entry)
+{
+    uint32_t frame = entry->frame;
+    int new_frame = obtainFrame();
+    if (new_frame < 0)
+    {
+        return false;
+    }
+    char *memory = (char*)_frames->getMemory();
+    memcpy(memory + (size_t)new_frame * _page_size, memory + (size_t)frame * _page_size, _page_size);
+    _cow_faults++;
+
+    if (_tlb != NULL)
+    {
+        _tlb->invalidate(pid, page);
+    }
+    ProcessPageTable *table = findTable(pid);
+    beginUpdate(table);
+    loadFrame(pid, page, entry, new_frame, -1);
+    endUpdate(table);
+    dropSharer(frame, entry);
+    return true;
+}
+
+// Turns the private frame of a resident page into a shared one. It leaves
+// the replacement policy: evicting it would have to unmap every sharer.
+void PageTable::shareFrame(uint32_t frame)
+{
+    FrameOwner *owner = &_owners[frame];
+    if (_replacement != NULL)
+    {
+        _replacement->frameReleased(frame);
+    }
+    _sharers[frame].push_back(*owner);
+    _frame_refs[frame] = 1;
+    _shared_frames++;
+    _pinned_pages++;
+
+    ProcessPageTable *table = findTable(owner->pid);
+    beginUpdate(table);
+    storeEntry(owner->entry, frame, owner->entry->flags | PTE_COW);
+    endUpdate(table);
+    owner->entry = NULL;
+}
+
+//the caller points entry at the frame
+void PageTable::addSharer(uint32_t frame, uint32_t pid, uint32_t page, PageTableEntry *entry)
+{
+    FrameOwner sharer;
+    sharer.pid = pid;
+    sharer.page = page;
+    sharer.entry = entry;
+    sharer.swap_slot = -1;
+    _sharers[frame].push_back(sharer);
+    if (++_frame_refs[frame] > 1)
+    {
+        _frames_saved++;
+    }
+    _pinned_pages++;
+}
+
+// Takes one mapping off a shared frame. A segment frame is freed with its
+// last mapping; a copy-on-write frame goes back to being the private frame
+// of the last page left mapping it.
+void PageTable::dropSharer(uint32_t frame, PageTableEntry *entry)
+{
+    std::vector<FrameOwner> &sharers = _sharers[frame];
+    for (size_t i = 0; i < sharers.size(); i++)
+    {
+        if (sharers[i].entry == entry)
+        {
+            sharers[i] = sharers.back();
+            sharers.pop_back();
+            break;
+        }
+    }
+    _pinned_pages--;
+    if (--_frame_refs[frame] != 0)
+    {
+        _frames_saved--;
+    }
+
+    std::unordered_map<uint32_t, SharedSegment*>::iterator segment = _segment_frames.find(frame);
+    if (segment != _segment_frames.end())
+    {
+        if (_frame_refs[frame] != 0)
+        {
+            return;
+        }
+        SharedSegment *unmapped = segment->second;
+        _segment_frames.erase(segment);
+        _sharers.erase(frame);
+        _shared_frames--;
+        freeFrame(frame);
+        if (--unmapped->live_frames == 0)
+        {
+            _segments.erase(unmapped->name);
+            delete unmapped;
+        }
+        return;
+    }
+    if (_frame_refs[frame] > 1)
+    {
+        return;
+    }
+
+    FrameOwner *owner = &_owners[frame];
+    owner->pid = sharers[0].pid;
+    owner->page = sharers[0].page;
+    owner->entry = sharers[0].entry;
+    _sharers.erase(frame);
+    _frame_refs[frame] = 0;
+    _shared_frames--;
+    _pinned_pages--;
+
+    //merged pages of one process may be the last to map a frame while that
+    //process is being removed; its table is unpublished and already mid update
+    ProcessPageTable *table = findTable(owner->pid);
+    if (table == NULL)
+    {
+        storeEntry(owner->entry, frame, owner->entry->flags & ~PTE_COW);
+    }
+    else
+    {
+        beginUpdate(table);
+        storeEntry(owner->entry, frame, owner->entry->flags & ~PTE_COW);
+        endUpdate(table);
+    }
+    if (_replacement != NULL)
+    {
+        _replacement->frameLoaded(frame);
+    }
+    recordReference(owner->pid, owner->page);
+}
+
+bool PageTable::findSegment(const std::string& name, uint32_t *size)
+{
+    std::unordered_map<std::string, SharedSegment*>::iterator it = _segments.find(name);
+    if (it == _segments.end())
+    {
+        return false;
+    }
+    *size = it->second->size;
+    return true;
+}
+
+// Maps segment name at first_page of pid, creating it with size bytes of
+// zeroed frames the first time. The pages must not be mapped yet. Returns
+// false if a new segment finds no frames for all of its pages.
+bool PageTable::attachSegment(uint32_t pid, const std::string& name, uint32_t size, uint32_t first_page)
+{
+    uint32_t i;
+    SharedSegment *segment;
+    std::unordered_map<std::string, SharedSegment*>::iterator it = _segments.find(name);
+    if (it != _segments.end())
+    {
+        segment = it->second;
+    }
+    else
+    {
+        segment = new SharedSegment();
+        segment->name = name;
+        segment->size = size;
+        for (i = 0; i < (size + _page_size - 1) / _page_size; i++)
+        {
+            int frame = obtainFrame();
+            if (frame < 0)
+            {
+                for (i = 0; i < segment->frames.size(); i++)
+                {
+                    _frames->release(segment->frames[i]);
+                }
+                delete segment;
+                return false;
+            }
+            memset((char*)_frames->getMemory() + (size_t)frame * _page_size, 0, _page_size);
+            _owners[frame].entry = NULL;
+            _owners[frame].swap_slot = -1;
+            segment->frames.push_back(frame);
+        }
+        for (i = 0; i < segment->frames.size(); i++)
+        {
+            _segment_frames[segment->frames[i]] = segment;
+        }
+        segment->live_frames = segment->frames.size();
+        _shared_frames += segment->frames.size();
+        _segments[name] = segment;
+    }
+
+    for (i = 0; i < segment->frames.size(); i++)
+    {
+        uint32_t page = first_page + i;
+        uint32_t frame = segment->frames[i];
+        ProcessPageTable *table;
+        PageTableLeaf *leaf = createLeaf(pid, page, &table);
+        PageTableEntry *entry = &leaf->entries[page & PT_LEVEL_MASK];
+        addSharer(frame, pid, page, entry);
+        beginUpdate(table);
+        storeEntry(entry, frame, PTE_PRESENT | PTE_SHARED);
+        endUpdate(table);
+        addRange(table, page);
+        leaf->used++;
+        table->mapped++;
+        table->resident++;
+        _mapped_pages++;
+    }
+    return true;
+}
+
+static uint64_t hashPage(const char *data, uint32_t length)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    uint64_t word;
+    uint32_t i;
+    for (i = 0; i + sizeof(word) <= length; i += sizeof(word))
+    {
+        memcpy(&word, data + i, sizeof(word));
+        hash = (hash ^ word) * 1099511628211ULL;
+    }
+    for (; i < length; i++)
+    {
+        hash = (hash ^ (uint8_t)data[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Same page merging: every resident private page whose contents match an
+// earlier frame's is pointed at that frame, copy-on-write, and its own frame
+// is freed. Large pages and segments are left alone. Returns the pages merged.
+uint32_t PageTable::mergePages()
+{
+    uint32_t frame, i;
+    uint32_t merged = 0;
+    const char *memory = (const char*)_frames->getMemory();
+    std::unordered_map<uint64_t, std::vector<uint32_t> > by_hash;
+    for (frame = 0; frame < _owners.size(); frame++)
+    {
+        PageTableEntry *entry = _owners[frame].entry;
+        bool private_page = entry != NULL && !(entry->flags & PTE_LARGE);
+        bool cow_frame = _frame_refs[frame] != 0 && _segment_frames.count(frame) == 0;
+        if (!private_page && !cow_frame)
+        {
+            continue;
+        }
+
+        std::vector<uint32_t> &candidates = by_hash[hashPage(memory + (size_t)frame * _page_size, _page_size)];
+        for (i = 0; i < candidates.size(); i++)
+        {
+            if (memcmp(memory + (size_t)frame * _page_size, memory + (size_t)candidates[i] * _page_size, _page_size) == 0)
+            {
+                break;
+            }
+        }
+        if (i == candidates.size())
+        {
+            candidates.push_back(frame);
+        }
+        else if (private_page)
+        {
+            mergeFrame(frame, candidates[i]);
+            merged++;
+        }
+    }
+
+    _merge_passes++;
+    _merged_pages += merged;
+    return merged;
+}
+
+//maps the page in the private frame onto target, which has the same contents, and frees the frame
+void PageTable::mergeFrame(uint32_t frame, uint32_t target)
+{
+    if (_frame_refs[target] == 0)
+    {
+        shareFrame(target);
+    }
+
+    //the sharers agree on whether the frame matches its copy in swap
+    FrameOwner owner = _owners[frame];
+    uint32_t dirty = _sharers[target][0].entry->flags & PTE_DIRTY;
+    addSharer(target, owner.pid, owner.page, owner.entry);
+    if (_tlb != NULL)
+    {
+        _tlb->invalidate(owner.pid, owner.page);
+    }
+    ProcessPageTable *table = findTable(owner.pid);
+    beginUpdate(table);
+    storeEntry(owner.entry, target, PTE_PRESENT | PTE_COW | dirty | (owner.entry->flags & PTE_ACCESSED));
+    endUpdate(table);
+
+    if (_replacement != NULL)
+    {
+        _replacement->frameReleased(frame);
+    }
+    freeFrame(frame);
+}
+
+int PageTable::getPhysicalAddress(uint32_t pid, uint32_t virtual_address)
+{
+    return getPhysicalAddress(pid, virtual_address, false);
+}
+
+int PageTable::getPhysicalAddress(uint32_t pid, uint32_t virtual_address, bool write)
+{
+    // Convert virtual address to page_number and page_offset
+    uint32_t page_number = virtual_address / _page_size;
+    uint32_t page_offset = virtual_address % _page_size;
+
+    uint32_t frame;
+    if (_tlb != NULL && _tlb->lookup(pid, page_number, &frame))
+    {
+        //a write to a shared frame goes on below to get its own copy
+        bool shared = isSharedFrame(frame);
+        if (!shared || !write)
+        {
+            if (write)
+            {
+                markEntry(_owners[frame].entry, PTE_DIRTY);
+            }
+            touchFrame(pid, page_number, frame, shared || isLargeFrame(frame));
+            return frame * _page_size + page_offset;
+        }
+    }
+
+    // If entry exists, look up frame number and convert virtual to physical address
+    PageTableEntry *entry = findEntry(pid, page_number);
+    if (entry == NULL)
+    {
+        return -1;
+    }
+
+    if (entry->flags & PTE_PRESENT)
+    {
+        if (write && (entry->flags & PTE_COW))
+        {
+            if (!copyOnWrite(pid, page_number, entry))
+            {
+                return -1;
+            }
+        }
+        else
+        {
+            touchFrame(pid, page_number, entry->frame, entry->flags & (PTE_LARGE | PTE_COW | PTE_SHARED));
+        }
+    }
+    else if (entry->flags & PTE_ZERO)
+    {
+        if (!touchZeroPage(pid, page_number, entry))
+        {
+            return -1;
+        }
+    }
+    else if (!pageIn(pid, page_number, entry))
+    {
+        return -1;
+    }
+
+    markEntry(entry, PTE_ACCESSED | (write ? PTE_DIRTY : 0));
+    if (_tlb != NULL && (entry->flags & PTE_LARGE))
+    {
+        uint32_t index = page_number % PT_LARGE_PAGES;
+        _tlb->insertLarge(pid, page_number - index, entry->frame - index, PT_LARGE_PAGES);
+    }
+    else if (_tlb != NULL)
+    {
+        _tlb->insert(pid, page_number, entry->frame);
+    }
+    return entry->frame * _page_size + page_offset;
 }
 
-std::vector<std::string> PageTable::sortedKeys()
+// Copies a range into a process' address space, translating once per page
+// and moving each page sized piece with a single memcpy
+bool PageTable::writeVirtual(uint32_t pid, uint32_t virtual_address, const void *data, uint32_t length)
 {
-    std::vector<std::string> keys;
-
-    std::map<std::string, int>::iterator it;
-    for (it = _table.begin(); it != _table.end(); it++)
+    const char *source = (const char*)data;
+    char *memory = (char*)_frames->getMemory();
+    while (length > 0)
     {
-        keys.push_back(it->first);
+        int physical = getPhysicalAddress(pid, virtual_address, true);
+        if (physical < 0)
+        {
+            return false;
+        }
+
+        uint32_t chunk = std::min(length, _page_size - virtual_address % _page_size);
+        memcpy(memory + physical, source, chunk);
+        source += chunk;
+        virtual_address += chunk;
+        length -= chunk;
     }
+    return true;
+}
+
+bool PageTable::readVirtual(uint32_t pid, uint32_t virtual_address, void *data, uint32_t length)
+{
+    char *destination = (char*)data;
+    char *memory = (char*)_frames->getMemory();
+    while (length > 0)
+    {
+        int physical = getPhysicalAddress(pid, virtual_address, false);
+        if (physical < 0)
+        {
+            return false;
+        }
 
-    std::sort(keys.begin(), keys.end(), PageTableKeyComparator());
+        uint32_t chunk = std::min(length, _page_size - virtual_address % _page_size);
+        memcpy(destination, memory + physical, chunk);
+        destination += chunk;
+        virtual_address += chunk;
+        length -= chunk;
+    }
+    return true;
+}
 
-    return keys;
+void PageTable::print()
+{
+    print(std::vector<PageTable*>(1, this));
 }
 
-void PageTable::addEntry(uint32_t pid, int page_number)
+//page tables of several shards are printed as one table ordered by pid
+void PageTable::print(const std::vector<PageTable*>& page_tables)
 {
-    // Combination of pid and page number act as the key to look up frame number
-    std::string entry = std::to_string(pid) + "|" + std::to_string(page_number);
+    int i;
 
-    std::vector<std::string> keys = sortedKeys();
-    int frame, i;
-    bool frames[keys.size()];
+    std::cout << " PID  | Page Number | Frame Number" << std::endl;
+    std::cout << "------+-------------+--------------" << std::endl;
 
-    // Find free frame
-    //Create collection of used frame numbers
-    std::map<std::string, int>::iterator it;
-    for (it = _table.begin(); it != _table.end(); it++)
+    std::vector<std::pair<uint32_t, ProcessPageTable*> > tables;
+    for (i = 0; i < page_tables.size(); i++)
     {
-        frames[it->second] = true;
+        std::unordered_map<uint32_t, ProcessPageTable*>::iterator it;
+        for (it = page_tables[i]->_tables.begin(); it != page_tables[i]->_tables.end(); it++)
+        {
+            tables.push_back(*it);
+        }
     }
+    std::sort(tables.begin(), tables.end());
 
-    //frame gets the first unused frame number or a new frame that is higher than the rest
-    frame = keys.size();
-    for(i = 0; i < keys.size(); i++) 
+    for (i = 0; i < tables.size(); i++)
     {
-        if(!frames[i]){
-            frame = i;
-            break;
+        uint32_t pid = tables[i].first;
+        ProcessPageTable *table = tables[i].second;
+        std::map<uint32_t, uint32_t>::iterator it;
+        for (it = table->ranges.begin(); it != table->ranges.end(); it++)
+        {
+            for (uint32_t page = it->first; page < it->second; page++)
+            {
+                PageTableEntry *entry = walk(table, page);
+                if (entry->flags & PTE_PRESENT)
+                {
+                    printf(" %4u | %11u | %12u \n", pid, page, entry->frame);
+                }
+                else
+                {
+                    printf(" %4u | %11u | %12s \n", pid, page, (entry->flags & PTE_ZERO) ? "untouched" : "swapped");
+                }
+            }
         }
     }
-
-    _table[entry] = frame;
 }
 
-int PageTable::getPhysicalAddress(uint32_t pid, uint32_t virtual_address)
+int PageTable::getNextPage(uint32_t pid)
 {
-    // Convert virtual address to page_number and page_offset
+    return getFreePage(pid, 0);
+}
 
-    // TODO: implement this!
-    int page_number = virtual_address / _page_size;
-    int page_offset = virtual_address % _page_size;
+//first unmapped page at or after from
+uint32_t PageTable::getFreePage(uint32_t pid, uint32_t from)
+{
+    ProcessPageTable *table = findTable(pid);
+    if (table == NULL)
+    {
+        return from;
+    }
 
-    // Combination of pid and page number act as the key to look up frame number
-    std::string entry = std::to_string(pid) + "|" + std::to_string(page_number);
+    std::map<uint32_t, uint32_t>::iterator it = table->ranges.upper_bound(from);
+    if (it == table->ranges.begin())
+    {
+        return from;
+    }
+    it--;
+    return (from < it->second) ? it->second : from;
+}
 
-    // If entry exists, look up frame number and convert virtual to physical address
-    int address = -1;
-    if (_table.count(entry) > 0)
+std::vector<std::pair<uint32_t, uint32_t> > PageTable::getMappedRanges(uint32_t pid)
+{
+    std::vector<std::pair<uint32_t, uint32_t> > ranges;
+    ProcessPageTable *table = findTable(pid);
+    if (table != NULL)
     {
-        address = _table.at(entry) * _page_size + page_offset;
+        ranges.assign(table->ranges.begin(), table->ranges.end());
     }
+    return ranges;
+}
 
-    return address;
+void PageTable::printProcesses()
+{
+    printProcesses(std::vector<PageTable*>(1, this));
 }
 
-void PageTable::print()
+void PageTable::printProcesses(const std::vector<PageTable*>& page_tables)
 {
     int i;
 
-    std::cout << " PID  | Page Number | Frame Number" << std::endl;
-    std::cout << "------+-------------+--------------" << std::endl;
+    std::vector<uint32_t> pids;
+    for (i = 0; i < page_tables.size(); i++)
+    {
+        std::vector<uint32_t> shard_pids = page_tables[i]->sortedPids();
+        pids.insert(pids.end(), shard_pids.begin(), shard_pids.end());
+    }
+    std::sort(pids.begin(), pids.end());
+
+    for (i = 0; i < pids.size(); i++)
+    {
+        std::cout << pids[i] << std::endl;
+    }
+}
+
+void PageTable::removeEntry(uint32_t pid, uint32_t page)
+{
+    PageTableEntry *entry = findEntry(pid, page);
+    if (entry == NULL)
+    {
+        return;
+    }
 
-    std::vector<std::string> keys = sortedKeys();
-    std::string separator = "|";
+    ProcessPageTable *table = findTable(pid);
+    if (entry->flags & PTE_LARGE)
+    {
+        demote(pid, table, page - page % PT_LARGE_PAGES);
+    }
+
+    bool resident = entry->flags & PTE_PRESENT;
+    beginUpdate(table);
+    releaseEntry(entry);
+    endUpdate(table);
+    removeRange(table, page);
+    if (_tlb != NULL)
+    {
+        _tlb->invalidate(pid, page);
+    }
+
+    //release table levels once they no longer hold any entries
+    PageTableMiddle *&middle = table->middles[page >> (2 * PT_LEVEL_BITS)];
+    PageTableLeaf *&leaf = middle->leaves[(page >> PT_LEVEL_BITS) & PT_LEVEL_MASK];
+
+    table->mapped--;
+    table->resident -= resident ? 1 : 0;
+    _mapped_pages--;
+    if (--leaf->used == 0)
+    {
+        PageTableLeaf *unlinked_leaf = leaf;
+        __atomic_store_n(&leaf, (PageTableLeaf*)NULL, __ATOMIC_RELEASE);
+        retireObject(unlinked_leaf);
+        if (--middle->used == 0)
+        {
+            PageTableMiddle *unlinked_middle = middle;
+            __atomic_store_n(&middle, (PageTableMiddle*)NULL, __ATOMIC_RELEASE);
+            retireObject(unlinked_middle);
+            table->used--;
+        }
+    }
 
-    for (i = 0; i < keys.size(); i++)
+    if (table->mapped == 0)
     {
-        size_t sepPosition = keys[i].find(separator);
-        int PID = stoi(keys[i].substr(0, sepPosition));
-        int pageNum = stoi(keys[i].substr(sepPosition + 1));
-        //std::cout << " " << PID << " |\t\t  " << pageNum << " |\t\t " << _table[keys[i]] << std::endl;
-        printf(" %4d | %11d | %12d \n", PID, pageNum, _table[keys[i]]);
+        _tables.erase(pid);
+        _last_table = NULL;
+        publishTables();
+        retireObject(table);
     }
 }
 
-int PageTable::getNextPage(uint32_t pid)
+void PageTable::removeProcess(uint32_t pid)
 {
-    int i = 0;
-    std::string entry = std::to_string(pid) + "|" + std::to_string(i);
+    ProcessPageTable *table = findTable(pid);
+    if (table == NULL)
+    {
+        return;
+    }
+
+    //unpublished first, so new readers no longer find the table being freed
+    _mapped_pages -= table->mapped;
+    _tables.erase(pid);
+    _last_table = NULL;
+    publishTables();
+    freeTable(table);
+
+    if (_tlb != NULL)
+    {
+        _tlb->flush(pid);
+    }
+}
 
-    while(_table.count(entry) > 0){
-        i++;
-        entry = std::to_string(pid) + "|" + std::to_string(i);
+void PageTable::removeAllProcesses()
+{
+    size_t i;
+    std::vector<uint32_t> pids = sortedPids();
+    for (i = 0; i < pids.size(); i++)
+    {
+        removeProcess(pids[i]);
     }
 
-    return i;
+    //only a snapshot that failed to load leaves segments without mappings
+    std::unordered_map<std::string, SharedSegment*>::iterator it;
+    for (it = _segments.begin(); it != _segments.end(); it++)
+    {
+        for (i = 0; i < it->second->frames.size(); i++)
+        {
+            _segment_frames.erase(it->second->frames[i]);
+            _sharers.erase(it->second->frames[i]);
+            _frames->release(it->second->frames[i]);
+            _shared_frames--;
+        }
+        delete it->second;
+    }
+    _segments.clear();
 }
 
-void PageTable::printProcesses()
+bool PageTable::save(SnapshotWriter& out)
 {
-    int PID = 1023;
+    size_t i;
+    std::vector<char> data(_page_size);
+    out.putVarint(_faults);
+    out.putVarint(_evictions);
+    out.putVarint(_writebacks);
+    out.putVarint(_forks);
+    out.putVarint(_cow_faults);
+    out.putVarint(_merge_passes);
+    out.putVarint(_merged_pages);
+    out.putVarint(_first_touch_faults);
 
-    std::map<std::string, int>::iterator it;
-    for (it = _table.begin(); it != _table.end(); it++)
+    out.putVarint(_segments.size());
+    std::unordered_map<std::string, SharedSegment*>::iterator it;
+    for (it = _segments.begin(); it != _segments.end(); it++)
     {
-        size_t separator = it->first.find("|");
-        uint32_t pid = std::stoi(it->first.substr(0, separator)); 
+        out.putName(it->second->name);
+        out.putVarint(it->second->size);
+        out.putVarint(it->second->frames.size());
+        for (i = 0; i < it->second->frames.size(); i++)
+        {
+            out.putVarint(it->second->frames[i]);
+        }
+    }
 
-        //when a new pid is found
-        if(pid != PID)
+    std::vector<uint32_t> pids = sortedPids();
+    out.putVarint(pids.size());
+    for (i = 0; i < pids.size(); i++)
+    {
+        ProcessPageTable *table = findTable(pids[i]);
+        out.putVarint(pids[i]);
+        out.putVarint(table->ranges.size());
+        std::map<uint32_t, uint32_t>::iterator range;
+        for (range = table->ranges.begin(); range != table->ranges.end(); range++)
         {
-            //update pid
-            PID = pid;
-            //print pid
-            std::cout << pid << std::endl;
+            out.putVarint(range->first);
+            out.putVarint(range->second - range->first);
+            for (uint32_t page = range->first; page < range->second; page++)
+            {
+                PageTableEntry *entry = walk(table, page);
+                out.putVarint(entry->flags);
+                if (entry->flags & PTE_ZERO)
+                {
+                    continue;
+                }
+                if (!(entry->flags & PTE_SWAPPED))
+                {
+                    out.putVarint(entry->frame);
+                    if (!(entry->flags & (PTE_LARGE | PTE_COW | PTE_SHARED)))
+                    {
+                        out.putByte(_owners[entry->frame].swap_slot >= 0 ? 1 : 0);
+                    }
+                }
+                else if (_swap->read(entry->frame, &data[0]))
+                {
+                    out.putBytes(&data[0], _page_size);
+                }
+                else
+                {
+                    return false;
+                }
+            }
         }
     }
+
+    SnapshotWriter policy;
+    _replacement->save(policy);
+    out.putByte(_replacement->getType());
+    out.putVarint(policy.getData().size());
+    out.putBytes(policy.getData().data(), policy.getData().size());
+    return true;
 }
 
-void PageTable::removeEntry(uint32_t pid, uint32_t page)
+// Frames are claimed as the pages using them are read. On failure the
+// caller removes all processes, which releases whatever was loaded. Memory
+// already holds the snapshot's image.
+bool PageTable::load(SnapshotReader& in)
+{
+    uint32_t i, j, count, ranges;
+    uint32_t num_frames = _frames->getNumFrames();
+    std::vector<uint8_t> loaded(num_frames, 0);
+    if (!in.getVarint(&_faults) || !in.getVarint(&_evictions) || !in.getVarint(&_writebacks) || !in.getVarint(&_forks)
+        || !in.getVarint(&_cow_faults) || !in.getVarint(&_merge_passes) || !in.getVarint(&_merged_pages) || !in.getVarint(&_first_touch_faults)
+        || !in.getVarint32(&count))
+    {
+        return false;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        std::string_view name;
+        uint32_t size, frames;
+        if (!in.getName(&name) || !in.getVarint32(&size) || !in.getVarint32(&frames) || _segments.count(std::string(name)) != 0)
+        {
+            return false;
+        }
+        SharedSegment *segment = new SharedSegment();
+        segment->name = name;
+        segment->size = size;
+        segment->live_frames = 0;
+        _segments[segment->name] = segment;
+        for (j = 0; j < frames; j++)
+        {
+            uint32_t frame;
+            if (!in.getVarint32(&frame) || !_frames->claim(frame))
+            {
+                return false;
+            }
+            _owners[frame].entry = NULL;
+            _owners[frame].swap_slot = -1;
+            _frame_refs[frame] = 0;
+            _segment_frames[frame] = segment;
+            segment->frames.push_back(frame);
+            segment->live_frames++;
+            _shared_frames++;
+        }
+    }
+
+    if (!in.getVarint32(&count))
+    {
+        return false;
+    }
+    for (i = 0; i < count; i++)
+    {
+        uint32_t pid;
+        if (!in.getVarint32(&pid) || findTable(pid) != NULL || !in.getVarint32(&ranges))
+        {
+            return false;
+        }
+        for (j = 0; j < ranges; j++)
+        {
+            uint32_t first, length;
+            if (!in.getVarint32(&first) || !in.getVarint32(&length) || (uint64_t)first + length > PT_MAX_PAGES)
+            {
+                return false;
+            }
+            for (uint32_t page = first; page < first + length; page++)
+            {
+                uint32_t flags, frame;
+                const uint8_t *data;
+                if (!in.getVarint32(&flags))
+                {
+                    return false;
+                }
+                if (flags & PTE_SWAPPED)
+                {
+                    if (!in.getBytes(_page_size, &data))
+                    {
+                        return false;
+                    }
+                }
+                else if (flags != PTE_ZERO && (!(flags & PTE_PRESENT) || !in.getVarint32(&frame) || frame >= num_frames))
+                {
+                    return false;
+                }
+                uint8_t swap_copy = 0;
+                if (!(flags & (PTE_SWAPPED | PTE_LARGE | PTE_COW | PTE_SHARED | PTE_ZERO)) && !in.getByte(&swap_copy))
+                {
+                    return false;
+                }
+
+                ProcessPageTable *table;
+                PageTableLeaf *leaf = createLeaf(pid, page, &table);
+                PageTableEntry *entry = &leaf->entries[page & PT_LEVEL_MASK];
+                if (entry->flags != 0)
+                {
+                    return false;
+                }
+
+                if (flags == PTE_ZERO)
+                {
+                    storeEntry(entry, 0, PTE_ZERO);
+                    _untouched_pages++;
+                }
+                else if (flags & PTE_SWAPPED)
+                {
+                    int slot = _swap->allocate();
+                    if (!_swap->write(slot, data))
+                    {
+                        _swap->release(slot);
+                        return false;
+                    }
+                    storeEntry(entry, slot, PTE_SWAPPED);
+                    _swapped_pages++;
+                }
+                else
+                {
+                    //a segment frame is claimed with its segment, a copy-on-write frame by its first page
+                    bool segment = _segment_frames.count(frame) != 0;
+                    bool first_use = _frame_refs[frame] == 0;
+                    if (((flags & PTE_SHARED) != 0) != segment || (!(flags & (PTE_COW | PTE_SHARED)) && !first_use))
+                    {
+                        return false;
+                    }
+                    if (!segment && first_use && !_frames->claim(frame))
+                    {
+                        return false;
+                    }
+                    if (flags & (PTE_COW | PTE_SHARED))
+                    {
+                        if (!segment && first_use)
+                        {
+                            _owners[frame].entry = NULL;
+                            _owners[frame].swap_slot = -1;
+                            _shared_frames++;
+                        }
+                        addSharer(frame, pid, page, entry);
+                    }
+                    else
+                    {
+                        FrameOwner *owner = &_owners[frame];
+                        owner->pid = pid;
+                        owner->page = page;
+                        owner->entry = entry;
+                        owner->swap_slot = -1;
+                        if (flags & PTE_LARGE)
+                        {
+                            _pinned_pages++;
+                        }
+                        else
+                        {
+                            loaded[frame] = 1;
+                        }
+                    }
+                    storeEntry(entry, frame, flags);
+                    table->resident++;
+
+                    //the slot number changes, the copy in it is the page as it is in memory
+                    if (swap_copy)
+                    {
+                        int slot = _swap->allocate();
+                        if (!_swap->write(slot, (char*)_frames->getMemory() + (size_t)frame * _page_size))
+                        {
+                            _swap->release(slot);
+                            return false;
+                        }
+                        _owners[frame].swap_slot = slot;
+                    }
+                }
+
+                if ((flags & PTE_LARGE) && page % PT_LARGE_PAGES == 0)
+                {
+                    table->large++;
+                    _large_pages++;
+                }
+                addRange(table, page);
+                leaf->used++;
+                table->mapped++;
+                _mapped_pages++;
+            }
+        }
+    }
+
+    //a copy-on-write frame is mapped at least twice, a segment frame at least once
+    std::unordered_map<uint32_t, std::vector<FrameOwner> >::iterator sharers;
+    for (sharers = _sharers.begin(); sharers != _sharers.end(); sharers++)
+    {
+        if (sharers->second.size() < (_segment_frames.count(sharers->first) != 0 ? 1 : 2))
+        {
+            return false;
+        }
+    }
+    if (_sharers.size() != _shared_frames)
+    {
+        return false;
+    }
+
+    //the saved eviction order when the policy is the same, load order by frame otherwise
+    uint8_t policy;
+    uint64_t length;
+    const uint8_t *skipped;
+    if (!in.getByte(&policy) || !in.getVarint(&length))
+    {
+        return false;
+    }
+    if (policy == _replacement->getType())
+    {
+        size_t start = in.getPosition();
+        return _replacement->load(in, loaded) && in.getPosition() - start == length;
+    }
+    if (!in.getBytes(length, &skipped))
+    {
+        return false;
+    }
+    for (i = 0; i < num_frames; i++)
+    {
+        if (loaded[i])
+        {
+            _replacement->frameLoaded(i);
+        }
+    }
+    return true;
+}
+
+void PageTable::enableConcurrentReaders()
+{
+    if (_epochs != NULL)
+    {
+        return;
+    }
+
+    _epochs = new EpochManager();
+    _published = new ProcessTableIndex(_tables);
+}
+
+int PageTable::registerReader()
+{
+    return _epochs->registerReader();
+}
+
+EpochManager* PageTable::getEpochs()
+{
+    return _epochs;
+}
+
+// Walks the levels without locks; only called between enter() and leave(), so
+// nothing it reaches is freed under it. Returns the sequence number the walk
+// was validated against, for callers that read the frame afterwards.
+bool PageTable::walkConcurrent(uint32_t pid, uint32_t page, uint32_t *frame, ProcessPageTable **table, uint32_t *sequence)
+{
+    if (page >= PT_MAX_PAGES)
+    {
+        return false;
+    }
+
+    while (true)
+    {
+        ProcessTableIndex *index = _published.load();
+        ProcessTableIndex::const_iterator it = index->find(pid);
+        if (it == index->end())
+        {
+            return false;
+        }
+
+        //odd while the writer changes a mapping of this process
+        ProcessPageTable *current = it->second;
+        uint32_t before = __atomic_load_n(&current->sequence, __ATOMIC_ACQUIRE);
+        if (before & 1)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        uint32_t flags = 0;
+        uint32_t value = 0;
+        PageTableMiddle *middle = __atomic_load_n(&current->middles[page >> (2 * PT_LEVEL_BITS)], __ATOMIC_ACQUIRE);
+        PageTableLeaf *leaf = NULL;
+        if (middle != NULL)
+        {
+            leaf = __atomic_load_n(&middle->leaves[(page >> PT_LEVEL_BITS) & PT_LEVEL_MASK], __ATOMIC_ACQUIRE);
+        }
+        if (leaf != NULL)
+        {
+            PageTableEntry *entry = &leaf->entries[page & PT_LEVEL_MASK];
+            flags = __atomic_load_n(&entry->flags, __ATOMIC_ACQUIRE);
+            value = __atomic_load_n(&entry->frame, __ATOMIC_RELAXED);
+        }
+
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&current->sequence, __ATOMIC_RELAXED) != before)
+        {
+            continue;
+        }
+
+        *frame = value;
+        *table = current;
+        *sequence = before;
+        return (flags & PTE_PRESENT) != 0;
+    }
+}
+
+bool PageTable::translate(int reader, uint32_t pid, uint32_t virtual_address, uint32_t *physical_address)
+{
+    uint32_t frame;
+    uint32_t sequence;
+    ProcessPageTable *table;
+
+    _epochs->enter(reader);
+    bool found = walkConcurrent(pid, virtual_address / _page_size, &frame, &table, &sequence);
+    _epochs->leave(reader);
+
+    if (found)
+    {
+        *physical_address = frame * _page_size + virtual_address % _page_size;
+    }
+    return found;
+}
+
+bool PageTable::readConcurrent(int reader, uint32_t pid, uint32_t virtual_address, void *data, uint32_t length)
 {
-    std::string entry = std::to_string(pid) + "|" + std::to_string(page);
+    char *memory = (char*)_frames->getMemory();
+    char *destination = (char*)data;
+    bool found = true;
+
+    _epochs->enter(reader);
+    while (found && length > 0)
+    {
+        uint32_t frame;
+        uint32_t sequence;
+        ProcessPageTable *table;
+        uint32_t offset = virtual_address % _page_size;
+        uint32_t chunk = std::min(length, _page_size - offset);
+
+        found = walkConcurrent(pid, virtual_address / _page_size, &frame, &table, &sequence);
+        if (!found)
+        {
+            break;
+        }
+        memcpy(destination, memory + (size_t)frame * _page_size + offset, chunk);
+
+        //an eviction may have handed the frame to another page during the copy
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&table->sequence, __ATOMIC_RELAXED) != sequence)
+        {
+            continue;
+        }
 
-    //while entry exists
-    _table.erase(entry);
+        destination += chunk;
+        virtual_address += chunk;
+        length -= chunk;
+    }
+    _epochs->leave(reader);
+    return found;
 }
 
 int PageTable::getPageSize()
 {
     return _page_size;
 }
+
+ReplacementPolicyType PageTable::getReplacementType()
+{
+    return _replacement->getType();
+}
+
+void PageTable::printPaging()
+{
+    printPaging(std::vector<PageTable*>(1, this));
+}
+
+//shards share the frames but fault, evict and swap on their own
+void PageTable::printPaging(const std::vector<PageTable*>& page_tables)
+{
+    int i;
+    uint64_t faults = 0;
+    uint64_t evictions = 0;
+    uint64_t writebacks = 0;
+    uint64_t swap_slots = 0;
+    uint64_t first_touches = 0;
+    uint64_t mapped = 0;
+    uint64_t untouched = 0;
+    uint64_t swapped = 0;
+    for (i = 0; i < page_tables.size(); i++)
+    {
+        faults += page_tables[i]->_faults;
+        first_touches += page_tables[i]->_first_touch_faults;
+        mapped += page_tables[i]->_mapped_pages;
+        untouched += page_tables[i]->_untouched_pages;
+        swapped += page_tables[i]->_swapped_pages;
+        evictions += page_tables[i]->_evictions;
+        writebacks += page_tables[i]->_writebacks;
+        swap_slots += page_tables[i]->_swap == NULL ? 0 : page_tables[i]->_swap->getUsedSlots();
+    }
+
+    PageTable *first = page_tables[0];
+    printf("Replacement policy: %s\n", first->_replacement == NULL ? "none" : replacementPolicyToString(first->_replacement->getType()).c_str());
+    printf("Frames:             %u (%u in use)\n", first->_frames->getNumFrames(), first->_frames->getUsedFrames());
+    printf("Page faults:        %llu\n", (unsigned long long)faults);
+    printf("First-touch faults: %llu\n", (unsigned long long)first_touches);
+    printf("Resident pages:     %llu of %llu mapped (%llu untouched)\n", (unsigned long long)(mapped - untouched - swapped),
+           (unsigned long long)mapped, (unsigned long long)untouched);
+    printf("Evictions:          %llu\n", (unsigned long long)evictions);
+    printf("Write-backs:        %llu\n", (unsigned long long)writebacks);
+    printf("Swap slots in use:  %llu\n", (unsigned long long)swap_slots);
+}
+
+void PageTable::printLargePages()
+{
+    printLargePages(std::vector<PageTable*>(1, this));
+}
+
+// Every large page stands in for PT_LARGE_PAGES leaf entries and as many TLB
+// entries, both of which it covers with a single one
+void PageTable::printLargePages(const std::vector<PageTable*>& page_tables)
+{
+    int i;
+    uint64_t large = 0;
+
+    std::cout << " PID  | Large Pages | Base Pages | PTEs Needed | PTEs Saved " << std::endl;
+    std::cout << "------+-------------+------------+-------------+------------" << std::endl;
+
+    std::vector<std::pair<uint32_t, ProcessPageTable*> > tables;
+    for (i = 0; i < page_tables.size(); i++)
+    {
+        std::unordered_map<uint32_t, ProcessPageTable*>::iterator it;
+        for (it = page_tables[i]->_tables.begin(); it != page_tables[i]->_tables.end(); it++)
+        {
+            tables.push_back(*it);
+        }
+    }
+    std::sort(tables.begin(), tables.end());
+
+    for (i = 0; i < tables.size(); i++)
+    {
+        ProcessPageTable *table = tables[i].second;
+        uint32_t base = table->mapped - table->large * PT_LARGE_PAGES;
+        printf(" %4u | %11u | %10u | %11u | %10u \n", tables[i].first, table->large, base,
+               base + table->large, table->large * (PT_LARGE_PAGES - 1));
+        large += table->large;
+    }
+
+    PageTable *first = page_tables[0];
+    printf("Large pages:        %s\n", first->_large_pages_enabled ? "enabled" : "disabled");
+    printf("Large page size:    %u pages\n", PT_LARGE_PAGES);
+    printf("TLB entries saved:  %llu\n", (unsigned long long)(large * (PT_LARGE_PAGES - 1)));
+}
+
+void PageTable::printSharing()
+{
+    printSharing(std::vector<PageTable*>(1, this));
+}
+
+void PageTable::printSharing(const std::vector<PageTable*>& page_tables)
+{
+    int i;
+    uint64_t forks = 0;
+    uint64_t shared_frames = 0;
+    uint64_t frames_saved = 0;
+    uint64_t cow_faults = 0;
+    uint64_t segments = 0;
+    uint64_t merge_passes = 0;
+    uint64_t merged_pages = 0;
+    for (i = 0; i < page_tables.size(); i++)
+    {
+        forks += page_tables[i]->_forks;
+        shared_frames += page_tables[i]->_shared_frames;
+        frames_saved += page_tables[i]->_frames_saved;
+        cow_faults += page_tables[i]->_cow_faults;
+        segments += page_tables[i]->_segments.size();
+        merge_passes += page_tables[i]->_merge_passes;
+        merged_pages += page_tables[i]->_merged_pages;
+    }
+
+    printf("Forks:              %llu\n", (unsigned long long)forks);
+    printf("Shared frames:      %llu\n", (unsigned long long)shared_frames);
+    printf("Frames saved:       %llu\n", (unsigned long long)frames_saved);
+    printf("COW faults:         %llu\n", (unsigned long long)cow_faults);
+    printf("Segments:           %llu\n", (unsigned long long)segments);
+    printf("Merge passes:       %llu\n", (unsigned long long)merge_passes);
+    printf("Pages merged:       %llu\n", (unsigned long long)merged_pages);
+    printf("Memory saved:       %llu bytes\n", (unsigned long long)(frames_saved * page_tables[0]->_page_size));
+}
+
+void PageTable::setReferenceLog(std::vector<uint64_t> *log)
+{
+    _reference_log = log;
+}
+
+bool PageTable::getProcessPages(uint32_t pid, uint32_t *mapped, uint32_t *resident)
+{
+    ProcessPageTable *table = findTable(pid);
+    *mapped = (table == NULL) ? 0 : table->mapped;
+    *resident = (table == NULL) ? 0 : table->resident;
+    return table != NULL;
+}
+
+uint64_t PageTable::getMappedPages()
+{
+    return _mapped_pages;
+}
+
+uint64_t PageTable::getSwappedPages()
+{
+    return _swapped_pages;
+}
+
+uint64_t PageTable::getUntouchedPages()
+{
+    return _untouched_pages;
+}
+
+uint64_t PageTable::getFirstTouchFaults()
+{
+    return _first_touch_faults;
+}
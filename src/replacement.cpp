@@ -0,0 +1,472 @@
+#include <unordered_map>
+#include "replacement.h"
+
+#define NO_FRAME  0xFFFFFFFF
+#define NEVER_USED 0xFFFFFFFFFFFFFFFFULL
+
+// Reads count frames of a saved policy, each one loaded and seen only once
+static bool loadFrames(SnapshotReader& in, const std::vector<uint8_t>& loaded, std::vector<uint32_t>& frames)
+{
+    uint32_t i, count, frame;
+    std::vector<uint8_t> seen(loaded.size(), 0);
+    uint32_t expected = 0;
+    for (i = 0; i < loaded.size(); i++)
+    {
+        expected += loaded[i] ? 1 : 0;
+    }
+    if (!in.getVarint32(&count) || count != expected)
+    {
+        return false;
+    }
+    for (i = 0; i < count; i++)
+    {
+        if (!in.getVarint32(&frame) || frame >= loaded.size() || !loaded[frame] || seen[frame])
+        {
+            return false;
+        }
+        seen[frame] = 1;
+        frames.push_back(frame);
+    }
+    return true;
+}
+
+FrameListPolicy::FrameListPolicy(uint32_t num_frames)
+{
+    _prev.assign(num_frames, NO_FRAME);
+    _next.assign(num_frames, NO_FRAME);
+    _head = NO_FRAME;
+    _tail = NO_FRAME;
+}
+
+void FrameListPolicy::append(uint32_t frame)
+{
+    _prev[frame] = _tail;
+    _next[frame] = NO_FRAME;
+    if (_tail != NO_FRAME)
+    {
+        _next[_tail] = frame;
+    }
+    else
+    {
+        _head = frame;
+    }
+    _tail = frame;
+}
+
+void FrameListPolicy::unlink(uint32_t frame)
+{
+    if (_prev[frame] != NO_FRAME)
+    {
+        _next[_prev[frame]] = _next[frame];
+    }
+    else
+    {
+        _head = _next[frame];
+    }
+
+    if (_next[frame] != NO_FRAME)
+    {
+        _prev[_next[frame]] = _prev[frame];
+    }
+    else
+    {
+        _tail = _prev[frame];
+    }
+    _prev[frame] = NO_FRAME;
+    _next[frame] = NO_FRAME;
+}
+
+void FrameListPolicy::frameLoaded(uint32_t frame)
+{
+    append(frame);
+}
+
+void FrameListPolicy::frameReleased(uint32_t frame)
+{
+    if (_head == frame || _prev[frame] != NO_FRAME)
+    {
+        unlink(frame);
+    }
+}
+
+uint32_t FrameListPolicy::selectVictim()
+{
+    return _head;
+}
+
+void FrameListPolicy::save(SnapshotWriter& out)
+{
+    uint32_t count = 0;
+    uint32_t frame;
+    for (frame = _head; frame != NO_FRAME; frame = _next[frame])
+    {
+        count++;
+    }
+    out.putVarint(count);
+    for (frame = _head; frame != NO_FRAME; frame = _next[frame])
+    {
+        out.putVarint(frame);
+    }
+}
+
+bool FrameListPolicy::load(SnapshotReader& in, const std::vector<uint8_t>& loaded)
+{
+    size_t i;
+    std::vector<uint32_t> frames;
+    if (!loadFrames(in, loaded, frames))
+    {
+        return false;
+    }
+    for (i = 0; i < frames.size(); i++)
+    {
+        append(frames[i]);
+    }
+    return true;
+}
+
+FifoPolicy::FifoPolicy(uint32_t num_frames) : FrameListPolicy(num_frames)
+{
+}
+
+ReplacementPolicyType FifoPolicy::getType()
+{
+    return ReplaceFifo;
+}
+
+void FifoPolicy::frameAccessed(uint32_t frame)
+{
+    //load order only
+}
+
+LruPolicy::LruPolicy(uint32_t num_frames) : FrameListPolicy(num_frames)
+{
+}
+
+ReplacementPolicyType LruPolicy::getType()
+{
+    return ReplaceLru;
+}
+
+void LruPolicy::frameAccessed(uint32_t frame)
+{
+    if (_tail != frame)
+    {
+        unlink(frame);
+        append(frame);
+    }
+}
+
+ClockPolicy::ClockPolicy(uint32_t num_frames)
+{
+    _loaded.assign(num_frames, 0);
+    _referenced.assign(num_frames, 0);
+    _hand = 0;
+}
+
+ReplacementPolicyType ClockPolicy::getType()
+{
+    return ReplaceClock;
+}
+
+void ClockPolicy::frameLoaded(uint32_t frame)
+{
+    _loaded[frame] = 1;
+    _referenced[frame] = 1;
+}
+
+void ClockPolicy::frameAccessed(uint32_t frame)
+{
+    _referenced[frame] = 1;
+}
+
+void ClockPolicy::frameReleased(uint32_t frame)
+{
+    _loaded[frame] = 0;
+    _referenced[frame] = 0;
+}
+
+uint32_t ClockPolicy::selectVictim()
+{
+    //at most two sweeps: the first may only clear reference bits
+    while (true)
+    {
+        uint32_t frame = _hand;
+        _hand = (_hand + 1) % _loaded.size();
+        if (!_loaded[frame])
+        {
+            continue;
+        }
+        if (_referenced[frame])
+        {
+            _referenced[frame] = 0;
+            continue;
+        }
+        return frame;
+    }
+}
+
+void ClockPolicy::save(SnapshotWriter& out)
+{
+    uint32_t frame;
+    uint32_t count = 0;
+    for (frame = 0; frame < _loaded.size(); frame++)
+    {
+        count += _loaded[frame];
+    }
+    out.putVarint(_hand);
+    out.putVarint(count);
+    for (frame = 0; frame < _loaded.size(); frame++)
+    {
+        if (_loaded[frame])
+        {
+            out.putVarint(frame);
+        }
+    }
+    for (frame = 0; frame < _loaded.size(); frame++)
+    {
+        if (_loaded[frame])
+        {
+            out.putByte(_referenced[frame]);
+        }
+    }
+}
+
+bool ClockPolicy::load(SnapshotReader& in, const std::vector<uint8_t>& loaded)
+{
+    size_t i;
+    std::vector<uint32_t> frames;
+    if (!in.getVarint32(&_hand) || _hand >= _loaded.size() || !loadFrames(in, loaded, frames))
+    {
+        return false;
+    }
+    for (i = 0; i < frames.size(); i++)
+    {
+        if (!in.getByte(&_referenced[frames[i]]))
+        {
+            return false;
+        }
+        _loaded[frames[i]] = 1;
+    }
+    return true;
+}
+
+LfuPolicy::LfuPolicy(uint32_t num_frames)
+{
+    _counts.assign(num_frames, 0);
+    _last_used.assign(num_frames, 0);
+    _tick = 0;
+}
+
+ReplacementPolicyType LfuPolicy::getType()
+{
+    return ReplaceLfu;
+}
+
+void LfuPolicy::frameLoaded(uint32_t frame)
+{
+    _counts[frame] = 1;
+    _last_used[frame] = ++_tick;
+    _order.insert(LfuKey(_counts[frame], _last_used[frame], frame));
+}
+
+void LfuPolicy::frameAccessed(uint32_t frame)
+{
+    _order.erase(LfuKey(_counts[frame], _last_used[frame], frame));
+    _counts[frame]++;
+    _last_used[frame] = ++_tick;
+    _order.insert(LfuKey(_counts[frame], _last_used[frame], frame));
+}
+
+void LfuPolicy::frameReleased(uint32_t frame)
+{
+    _order.erase(LfuKey(_counts[frame], _last_used[frame], frame));
+}
+
+uint32_t LfuPolicy::selectVictim()
+{
+    return std::get<2>(*_order.begin());
+}
+
+void LfuPolicy::save(SnapshotWriter& out)
+{
+    std::set<LfuKey>::iterator it;
+    out.putVarint(_tick);
+    out.putVarint(_order.size());
+    for (it = _order.begin(); it != _order.end(); it++)
+    {
+        out.putVarint(std::get<2>(*it));
+    }
+    for (it = _order.begin(); it != _order.end(); it++)
+    {
+        out.putVarint(std::get<0>(*it));
+        out.putVarint(std::get<1>(*it));
+    }
+}
+
+bool LfuPolicy::load(SnapshotReader& in, const std::vector<uint8_t>& loaded)
+{
+    size_t i;
+    std::vector<uint32_t> frames;
+    if (!in.getVarint(&_tick) || !loadFrames(in, loaded, frames))
+    {
+        return false;
+    }
+    for (i = 0; i < frames.size(); i++)
+    {
+        uint32_t frame = frames[i];
+        if (!in.getVarint(&_counts[frame]) || !in.getVarint(&_last_used[frame]))
+        {
+            return false;
+        }
+        _order.insert(LfuKey(_counts[frame], _last_used[frame], frame));
+    }
+    return true;
+}
+
+OptPolicy::OptPolicy(uint32_t num_frames, const std::vector<uint64_t>& references)
+{
+    _frame_next.assign(num_frames, NEVER_USED);
+    _cursor = 0;
+
+    //walk the trace backwards remembering where each page is referenced next
+    std::unordered_map<uint64_t, uint64_t> seen;
+    _next_use.assign(references.size(), NEVER_USED);
+    for (size_t i = references.size(); i-- > 0;)
+    {
+        std::unordered_map<uint64_t, uint64_t>::iterator it = seen.find(references[i]);
+        if (it != seen.end())
+        {
+            _next_use[i] = it->second;
+            it->second = i;
+        }
+        else
+        {
+            seen[references[i]] = i;
+        }
+    }
+}
+
+ReplacementPolicyType OptPolicy::getType()
+{
+    return ReplaceOpt;
+}
+
+void OptPolicy::touch(uint32_t frame)
+{
+    //a run that diverges from the collected trace treats further pages as never used again
+    uint64_t next = _cursor < _next_use.size() ? _next_use[_cursor] : NEVER_USED;
+    _cursor++;
+
+    _order.erase(std::make_pair(_frame_next[frame], frame));
+    _frame_next[frame] = next;
+    _order.insert(std::make_pair(next, frame));
+}
+
+void OptPolicy::frameLoaded(uint32_t frame)
+{
+    touch(frame);
+}
+
+void OptPolicy::frameAccessed(uint32_t frame)
+{
+    touch(frame);
+}
+
+void OptPolicy::frameReleased(uint32_t frame)
+{
+    _order.erase(std::make_pair(_frame_next[frame], frame));
+    _frame_next[frame] = NEVER_USED;
+}
+
+uint32_t OptPolicy::selectVictim()
+{
+    return _order.rbegin()->second;
+}
+
+//next uses are positions in the reference string of the run that saved them, so only the frames are kept
+void OptPolicy::save(SnapshotWriter& out)
+{
+    std::set<std::pair<uint64_t, uint32_t> >::iterator it;
+    out.putVarint(_order.size());
+    for (it = _order.begin(); it != _order.end(); it++)
+    {
+        out.putVarint(it->second);
+    }
+}
+
+bool OptPolicy::load(SnapshotReader& in, const std::vector<uint8_t>& loaded)
+{
+    size_t i;
+    std::vector<uint32_t> frames;
+    if (!loadFrames(in, loaded, frames))
+    {
+        return false;
+    }
+    for (i = 0; i < frames.size(); i++)
+    {
+        _frame_next[frames[i]] = NEVER_USED;
+        _order.insert(std::make_pair(NEVER_USED, frames[i]));
+    }
+    return true;
+}
+
+ReplacementPolicy* createReplacementPolicy(ReplacementPolicyType type, uint32_t num_frames, const std::vector<uint64_t>& references)
+{
+    switch (type)
+    {
+        case ReplaceLru:
+            return new LruPolicy(num_frames);
+        case ReplaceClock:
+            return new ClockPolicy(num_frames);
+        case ReplaceLfu:
+            return new LfuPolicy(num_frames);
+        case ReplaceOpt:
+            return new OptPolicy(num_frames, references);
+        default:
+            return new FifoPolicy(num_frames);
+    }
+}
+
+ReplacementPolicyType stringToReplacementPolicy(std::string text, bool *valid)
+{
+    *valid = true;
+    if (text == "fifo")
+    {
+        return ReplaceFifo;
+    }
+    if (text == "lru")
+    {
+        return ReplaceLru;
+    }
+    if (text == "clock")
+    {
+        return ReplaceClock;
+    }
+    if (text == "lfu")
+    {
+        return ReplaceLfu;
+    }
+    if (text == "opt")
+    {
+        return ReplaceOpt;
+    }
+    *valid = false;
+    return ReplaceFifo;
+}
+
+std::string replacementPolicyToString(ReplacementPolicyType type)
+{
+    switch (type)
+    {
+        case ReplaceLru:
+            return "lru";
+        case ReplaceClock:
+            return "clock";
+        case ReplaceLfu:
+            return "lfu";
+        case ReplaceOpt:
+            return "opt";
+        default:
+            return "fifo";
+    }
+}
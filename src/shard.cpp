@@ -0,0 +1,203 @@
+#include "shard.h"
+
+// commands a shard collects before they are handed to its worker in one go
+#define SHARD_PUBLISH_BATCH 64
+
+// _awaited while the dispatcher is not waiting
+#define NO_TASK UINT64_MAX
+
+ShardPool::ShardPool(uint32_t num_shards, uint32_t window_size, ShardExecutor executor, void *context)
+{
+    uint32_t i;
+    _num_shards = num_shards;
+    _executor = executor;
+    _context = context;
+    _stopping = false;
+    _next_sequence = 0;
+    _next_output = 0;
+    _awaited = NO_TASK;
+
+    _window.resize(window_size);
+    for (i = 0; i < window_size; i++)
+    {
+        _window[i] = new ShardTask();
+        _window[i]->done = true;
+    }
+
+    for (i = 0; i < num_shards; i++)
+    {
+        _queues.push_back(new ShardQueue());
+    }
+    for (i = 0; i < num_shards; i++)
+    {
+        _queues[i]->worker = std::thread(&ShardPool::work, this, i);
+    }
+}
+
+ShardPool::~ShardPool()
+{
+    uint32_t i;
+    drain();
+
+    _stopping = true;
+    for (i = 0; i < _num_shards; i++)
+    {
+        std::lock_guard<std::mutex> guard(_queues[i]->lock);
+        _queues[i]->ready.notify_one();
+    }
+    for (i = 0; i < _num_shards; i++)
+    {
+        _queues[i]->worker.join();
+        delete _queues[i];
+    }
+    for (i = 0; i < _window.size(); i++)
+    {
+        delete _window[i];
+    }
+}
+
+uint32_t ShardPool::getNumShards()
+{
+    return _num_shards;
+}
+
+uint32_t ShardPool::shardOf(uint32_t pid)
+{
+    return pid % _num_shards;
+}
+
+ShardTask* ShardPool::nextTask()
+{
+    //the window is full: let half of it finish rather than waking up for every single command
+    writeFinished();
+    if (_next_sequence - _next_output == _window.size())
+    {
+        waitFor(_next_output + _window.size() / 2);
+        waitFor(_next_output);
+        writeFinished();
+    }
+
+    ShardTask *task = _window[_next_sequence % _window.size()];
+    task->sequence = _next_sequence++;
+    task->pid = 0;
+    task->binary = false;
+    task->output.clear();
+    task->done = false;
+    return task;
+}
+
+void ShardPool::submit(ShardTask *task, uint32_t shard)
+{
+    ShardQueue *queue = _queues[shard];
+    queue->pending.push_back(task);
+    if (queue->pending.size() >= SHARD_PUBLISH_BATCH)
+    {
+        publish(shard);
+    }
+}
+
+void ShardPool::drain()
+{
+    if (_next_output < _next_sequence)
+    {
+        waitFor(_next_sequence - 1);
+    }
+    while (_next_output < _next_sequence)
+    {
+        waitFor(_next_output);
+        writeFinished();
+    }
+}
+
+void ShardPool::publish(uint32_t shard)
+{
+    ShardQueue *queue = _queues[shard];
+    if (queue->pending.empty())
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> guard(queue->lock);
+    queue->tasks.insert(queue->tasks.end(), queue->pending.begin(), queue->pending.end());
+    queue->pending.clear();
+    queue->ready.notify_one();
+}
+
+void ShardPool::publishAll()
+{
+    uint32_t i;
+    for (i = 0; i < _num_shards; i++)
+    {
+        publish(i);
+    }
+}
+
+//writes the output of finished commands, stopping at the oldest one still running
+void ShardPool::writeFinished()
+{
+    while (_next_output < _next_sequence)
+    {
+        ShardTask *task = _window[_next_output % _window.size()];
+        if (!task->done)
+        {
+            break;
+        }
+        std::cout.write(task->output.data(), task->output.size());
+        _next_output++;
+    }
+}
+
+void ShardPool::waitFor(uint64_t sequence)
+{
+    ShardTask *task = _window[sequence % _window.size()];
+    if (task->done)
+    {
+        return;
+    }
+
+    //the command may still sit in a batch that was never published
+    publishAll();
+
+    //a worker checks _awaited after setting done, so one of the two always sees the other
+    _awaited = sequence;
+    std::unique_lock<std::mutex> guard(_done_lock);
+    _done.wait(guard, [task] { return task->done.load(); });
+    _awaited = NO_TASK;
+}
+
+void ShardPool::work(uint32_t shard)
+{
+    size_t i;
+    ShardQueue *queue = _queues[shard];
+    std::vector<ShardTask*> tasks;
+    StringOutput buffer;
+    std::ostream out(&buffer);
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> guard(queue->lock);
+            queue->ready.wait(guard, [this, queue] { return _stopping || !queue->tasks.empty(); });
+            if (queue->tasks.empty())
+            {
+                break;
+            }
+            tasks.swap(queue->tasks);
+        }
+
+        for (i = 0; i < tasks.size(); i++)
+        {
+            buffer.setTarget(&tasks[i]->output);
+            _executor(tasks[i], shard, out, _context);
+            uint64_t sequence = tasks[i]->sequence;
+            tasks[i]->done = true;
+
+            if (_awaited == sequence)
+            {
+                std::lock_guard<std::mutex> guard(_done_lock);
+                _done.notify_one();
+            }
+        }
+        tasks.clear();
+    }
+}
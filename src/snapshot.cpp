@@ -0,0 +1,341 @@
+#include <cstring>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "snapshot.h"
+#include "mmu.h"
+#include "pagetable.h"
+#include "frameallocator.h"
+#include "tlb.h"
+#include "swap.h"
+#include "replacement.h"
+
+void SnapshotWriter::putByte(uint8_t value)
+{
+    _buffer.push_back(value);
+}
+
+void SnapshotWriter::putVarint(uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        _buffer.push_back((uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    _buffer.push_back((uint8_t)value);
+}
+
+void SnapshotWriter::putBytes(const void *data, size_t length)
+{
+    const uint8_t *bytes = (const uint8_t*)data;
+    _buffer.insert(_buffer.end(), bytes, bytes + length);
+}
+
+void SnapshotWriter::putName(std::string_view name)
+{
+    putVarint(name.length());
+    putBytes(name.data(), name.length());
+}
+
+const std::vector<uint8_t>& SnapshotWriter::getData()
+{
+    return _buffer;
+}
+
+static bool writeAll(int fd, const void *data, size_t length, off_t position)
+{
+    const char *bytes = (const char*)data;
+    while (length > 0)
+    {
+        ssize_t written = pwrite(fd, bytes, length, position);
+        if (written <= 0)
+        {
+            return false;
+        }
+        bytes += written;
+        length -= written;
+        position += written;
+    }
+    return true;
+}
+
+// The snapshot is written next to path and renamed over it, so a memory
+// image restored from an older snapshot at path keeps reading the old file
+bool SnapshotWriter::write(std::string path, FrameAllocator *frames)
+{
+    std::string temp_path = path + ".tmp";
+    int fd = ::open(temp_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    uint8_t header[SNAPSHOT_HEADER_SIZE] = {0};
+    uint64_t image_offset = (SNAPSHOT_HEADER_SIZE + _buffer.size() + SNAPSHOT_IMAGE_ALIGN - 1) / SNAPSHOT_IMAGE_ALIGN * SNAPSHOT_IMAGE_ALIGN;
+    memcpy(header, SNAPSHOT_MAGIC, 4);
+    header[4] = SNAPSHOT_VERSION;
+    memcpy(header + 8, &image_offset, sizeof(image_offset));
+
+    bool written = writeAll(fd, header, SNAPSHOT_HEADER_SIZE, 0)
+                && writeAll(fd, _buffer.data(), _buffer.size(), SNAPSHOT_HEADER_SIZE)
+                && frames->writeImage(fd, image_offset);
+    written = (::close(fd) == 0) && written;
+    if (!written || rename(temp_path.c_str(), path.c_str()) != 0)
+    {
+        unlink(temp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+SnapshotReader::SnapshotReader()
+{
+    _fd = -1;
+    _data = NULL;
+    _length = 0;
+    _position = 0;
+    _image_offset = 0;
+}
+
+SnapshotReader::~SnapshotReader()
+{
+    if (_data != NULL)
+    {
+        munmap((void*)_data, _length);
+    }
+    if (_fd >= 0)
+    {
+        ::close(_fd);
+    }
+}
+
+//only the metadata is mapped here, the image is mapped over memory once the metadata is loaded
+bool SnapshotReader::open(std::string path)
+{
+    _fd = ::open(path.c_str(), O_RDONLY);
+    if (_fd < 0)
+    {
+        return false;
+    }
+
+    uint8_t header[SNAPSHOT_HEADER_SIZE];
+    struct stat info;
+    if (pread(_fd, header, SNAPSHOT_HEADER_SIZE, 0) != SNAPSHOT_HEADER_SIZE || fstat(_fd, &info) != 0)
+    {
+        return false;
+    }
+    memcpy(&_image_offset, header + 8, sizeof(_image_offset));
+    if (memcmp(header, SNAPSHOT_MAGIC, 4) != 0 || header[4] != SNAPSHOT_VERSION
+        || _image_offset < SNAPSHOT_HEADER_SIZE || _image_offset > (uint64_t)info.st_size)
+    {
+        return false;
+    }
+
+    void *data = mmap(NULL, _image_offset, PROT_READ, MAP_PRIVATE, _fd, 0);
+    if (data == MAP_FAILED)
+    {
+        return false;
+    }
+    _data = (const uint8_t*)data;
+    _length = _image_offset;
+    _position = SNAPSHOT_HEADER_SIZE;
+    return true;
+}
+
+bool SnapshotReader::getByte(uint8_t *value)
+{
+    if (_position >= _length)
+    {
+        return false;
+    }
+    *value = _data[_position++];
+    return true;
+}
+
+bool SnapshotReader::getVarint(uint64_t *value)
+{
+    uint64_t result = 0;
+    int shift = 0;
+    while (_position < _length && shift < 64)
+    {
+        uint8_t byte = _data[_position++];
+        result |= (uint64_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            *value = result;
+            return true;
+        }
+        shift += 7;
+    }
+    return false;
+}
+
+bool SnapshotReader::getVarint32(uint32_t *value)
+{
+    uint64_t result;
+    if (!getVarint(&result) || result > UINT32_MAX)
+    {
+        return false;
+    }
+    *value = (uint32_t)result;
+    return true;
+}
+
+bool SnapshotReader::getBytes(size_t length, const uint8_t **data)
+{
+    if (length > _length - _position)
+    {
+        return false;
+    }
+    *data = _data + _position;
+    _position += length;
+    return true;
+}
+
+bool SnapshotReader::getName(std::string_view *name)
+{
+    uint64_t length;
+    const uint8_t *bytes;
+    if (!getVarint(&length) || !getBytes(length, &bytes))
+    {
+        return false;
+    }
+    *name = std::string_view((const char*)bytes, length);
+    return true;
+}
+
+size_t SnapshotReader::getPosition()
+{
+    return _position;
+}
+
+bool SnapshotReader::hasImage(uint64_t memory_size)
+{
+    struct stat info;
+    return fstat(_fd, &info) == 0 && (uint64_t)info.st_size >= _image_offset + memory_size;
+}
+
+bool SnapshotReader::mapImage(FrameAllocator *frames)
+{
+    return hasImage(frames->getMemorySize()) && frames->mapImage(_fd, _image_offset);
+}
+
+bool saveSnapshot(std::string path, Mmu *mmu, PageTable *page_table, FrameAllocator *frames)
+{
+    SnapshotWriter out;
+    out.putVarint(page_table->getPageSize());
+    out.putVarint(frames->getNumFrames());
+    out.putByte(mmu->getPolicyType());
+    mmu->save(out);
+    if (!page_table->save(out))
+    {
+        return false;
+    }
+    return out.write(path, frames);
+}
+
+static void removeAllProcesses(Mmu *mmu, PageTable *page_table)
+{
+    std::vector<Process*> processes = mmu->getProcesses();
+    for (size_t i = 0; i < processes.size(); i++)
+    {
+        mmu->removeProcess(processes[i]->pid);
+    }
+    page_table->removeAllProcesses();
+}
+
+//opens a snapshot taken with the same memory and allocation policy as the running simulator
+static bool openSnapshot(SnapshotReader& in, std::string path, Mmu *mmu, PageTable *page_table, FrameAllocator *frames)
+{
+    uint32_t page_size, num_frames;
+    uint8_t policy;
+    if (!in.open(path) || !in.getVarint32(&page_size) || !in.getVarint32(&num_frames) || !in.getByte(&policy))
+    {
+        return false;
+    }
+    return page_size == (uint32_t)page_table->getPageSize() && num_frames == frames->getNumFrames() && policy == mmu->getPolicyType()
+        && in.hasImage(frames->getMemorySize());
+}
+
+// Loads the whole snapshot into a scratch MMU and page table with memory and
+// swap of their own, so a corrupt file is found before live state changes
+static bool checkSnapshot(std::string path, Mmu *mmu, PageTable *page_table, FrameAllocator *frames)
+{
+    SnapshotReader in;
+    if (!openSnapshot(in, path, mmu, page_table, frames))
+    {
+        return false;
+    }
+
+    std::vector<uint64_t> references;
+    FrameAllocator scratch_frames(frames->getMemorySize(), frames->getFrameSize());
+    Mmu scratch_mmu(mmu->getMaxSize(), page_table->getPageSize(), mmu->getPolicyType());
+    Tlb tlb(0, 0, TlbLru);
+    SwapSpace swap("", page_table->getPageSize());
+    ReplacementPolicy *replacement = createReplacementPolicy(page_table->getReplacementType(), frames->getNumFrames(), references);
+    PageTable *scratch_table = new PageTable(page_table->getPageSize(), &scratch_frames, &tlb, replacement, &swap);
+
+    bool loaded = scratch_mmu.load(in) && scratch_table->load(in);
+    scratch_table->removeAllProcesses();
+    delete scratch_table;
+    delete replacement;
+    return loaded;
+}
+
+// Replaces every process with the ones in the snapshot. The snapshot is
+// checked in full first, so a snapshot that is corrupt, truncated or of a
+// different memory or allocation policy leaves the running processes, the
+// next pid and the statistics as they were.
+bool restoreSnapshot(std::string path, Mmu *mmu, PageTable *page_table, FrameAllocator *frames)
+{
+    SnapshotReader in;
+    if (!checkSnapshot(path, mmu, page_table, frames) || !openSnapshot(in, path, mmu, page_table, frames))
+    {
+        return false;
+    }
+
+    removeAllProcesses(mmu, page_table);
+    //the image goes first, the page table copies pages that had a copy in swap back out to swap
+    if (mmu->load(in) && in.mapImage(frames) && page_table->load(in))
+    {
+        return true;
+    }
+    //only an I/O error (mapping the image, writing swap) gets here once the check passed
+    removeAllProcesses(mmu, page_table);
+    return false;
+}
+
+bool readSnapshotTypes(std::string path, uint32_t *next_pid, std::unordered_map<uint32_t, std::unordered_map<std::string, DataType> >& types)
+{
+    SnapshotReader in;
+    uint32_t page_size, num_frames;
+    uint8_t policy;
+    if (!in.open(path) || !in.getVarint32(&page_size) || !in.getVarint32(&num_frames) || !in.getByte(&policy)
+        || page_size == 0 || policy > BuddyFit)
+    {
+        return false;
+    }
+
+    Mmu mmu(67108864, page_size, (AllocationPolicyType)policy);
+    if (!mmu.load(in))
+    {
+        return false;
+    }
+
+    Variable var;
+    std::vector<Process*> processes = mmu.getProcesses();
+    for (size_t i = 0; i < processes.size(); i++)
+    {
+        for (uint32_t row = 0; row < processes[i]->variables.getRowCount(); row++)
+        {
+            if (processes[i]->variables.getRow(row, &var))
+            {
+                types[processes[i]->pid][std::string(var.name)] = var.type;
+            }
+        }
+    }
+    *next_pid = mmu.getNextPid();
+    return true;
+}
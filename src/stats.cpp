@@ -0,0 +1,226 @@
+#include <algorithm>
+#include "stats.h"
+
+StatsEngine::StatsEngine(Mmu *mmu, PageTable *page_table, FrameAllocator *frames)
+{
+    _mmus.push_back(mmu);
+    _page_tables.push_back(page_table);
+    _frames = frames;
+    _series = NULL;
+    _format = StatsCsv;
+    _samples = 0;
+}
+
+StatsEngine::StatsEngine(const std::vector<Mmu*>& mmus, const std::vector<PageTable*>& page_tables, FrameAllocator *frames)
+{
+    _mmus = mmus;
+    _page_tables = page_tables;
+    _frames = frames;
+    _series = NULL;
+    _format = StatsCsv;
+    _samples = 0;
+}
+
+StatsEngine::~StatsEngine()
+{
+    closeSeries();
+}
+
+void StatsEngine::collect(uint64_t command, MemorySnapshot *snapshot)
+{
+    int i, j, b;
+    *snapshot = MemorySnapshot();
+    snapshot->command = command;
+
+    snapshot->frames_total = _frames->getNumFrames();
+    snapshot->frames_used = _frames->getUsedFrames();
+    int page_size = _page_tables[0]->getPageSize();
+    uint64_t requested = 0;
+    uint64_t reserved = 0;
+    uint64_t largest_sum = 0;
+    for (i = 0; i < _mmus.size(); i++)
+    {
+        snapshot->mapped_pages += _page_tables[i]->getMappedPages();
+        snapshot->swapped_pages += _page_tables[i]->getSwappedPages();
+        snapshot->untouched_pages += _page_tables[i]->getUntouchedPages();
+        snapshot->first_touch_faults += _page_tables[i]->getFirstTouchFaults();
+        snapshot->variable_bytes += _mmus[i]->getLiveVariableBytes();
+        snapshot->padding_bytes += _mmus[i]->getLivePaddingBytes();
+        requested += _mmus[i]->getPolicyStats().live_requested_bytes;
+        reserved += _mmus[i]->getPolicyStats().live_reserved_bytes;
+
+        //free space per process: the indexes keep totals, largest hole and histogram current
+        std::vector<Process*> processes = _mmus[i]->getProcesses();
+        for (j = 0; j < processes.size(); j++)
+        {
+            FreeSpaceIndex *free_space = &processes[j]->free_space;
+            snapshot->free_bytes += free_space->getTotalFree() + processes[j]->policy->getHeldBytes();
+            snapshot->largest_hole = std::max<uint64_t>(snapshot->largest_hole, free_space->getLargest());
+            snapshot->holes += free_space->getCount();
+            largest_sum += free_space->getLargest();
+
+            const uint32_t *histogram = free_space->getHistogram();
+            for (b = 0; b < FREE_HISTOGRAM_BUCKETS; b++)
+            {
+                snapshot->histogram[b] += histogram[b];
+            }
+        }
+    }
+    snapshot->mapped_bytes = snapshot->mapped_pages * page_size;
+    snapshot->resident_pages = snapshot->mapped_pages - snapshot->swapped_pages - snapshot->untouched_pages;
+
+    //reserved beyond what was asked for is either alignment padding or the policy rounding the block up
+    uint64_t slack = reserved - requested;
+    snapshot->rounding_bytes = slack > snapshot->padding_bytes ? slack - snapshot->padding_bytes : 0;
+
+    uint64_t occupied = snapshot->variable_bytes + snapshot->padding_bytes;
+    snapshot->unused_bytes = snapshot->mapped_bytes > occupied ? snapshot->mapped_bytes - occupied : 0;
+
+    snapshot->frame_utilization = snapshot->frames_total == 0 ? 0.0 : 100.0 * snapshot->frames_used / snapshot->frames_total;
+    snapshot->external_fragmentation = snapshot->free_bytes == 0 ? 0.0 :
+        100.0 * (snapshot->free_bytes - largest_sum) / snapshot->free_bytes;
+    snapshot->internal_fragmentation = reserved == 0 ? 0.0 : 100.0 * slack / reserved;
+    snapshot->page_rounding = snapshot->mapped_bytes == 0 ? 0.0 : 100.0 * snapshot->unused_bytes / snapshot->mapped_bytes;
+}
+
+void StatsEngine::print()
+{
+    int i, j, b;
+    MemorySnapshot snapshot;
+    collect(0, &snapshot);
+
+    printf("Frames:                 %u of %u in use (%.2f%% utilization)\n", snapshot.frames_used, snapshot.frames_total,
+           snapshot.frame_utilization);
+    printf("Pages:                  %llu mapped, %llu resident, %llu swapped out, %llu untouched\n",
+           (unsigned long long)snapshot.mapped_pages, (unsigned long long)snapshot.resident_pages,
+           (unsigned long long)snapshot.swapped_pages, (unsigned long long)snapshot.untouched_pages);
+    printf("First-touch faults:     %llu\n", (unsigned long long)snapshot.first_touch_faults);
+    printf("Free space:             %llu bytes in %llu holes (largest %llu)\n", (unsigned long long)snapshot.free_bytes,
+           (unsigned long long)snapshot.holes, (unsigned long long)snapshot.largest_hole);
+    printf("External fragmentation: %.2f%%\n", snapshot.external_fragmentation);
+    printf("Internal fragmentation: %.2f%% (%llu bytes padding, %llu bytes rounding)\n", snapshot.internal_fragmentation,
+           (unsigned long long)snapshot.padding_bytes, (unsigned long long)snapshot.rounding_bytes);
+    printf("Page rounding:          %.2f%% (%llu of %llu mapped bytes unused)\n", snapshot.page_rounding,
+           (unsigned long long)snapshot.unused_bytes, (unsigned long long)snapshot.mapped_bytes);
+
+    printf("Free hole sizes:\n");
+    for (b = 0; b < FREE_HISTOGRAM_BUCKETS; b++)
+    {
+        if (snapshot.histogram[b] != 0)
+        {
+            printf("  %10llu - %10llu | %llu\n", 1ULL << b, (2ULL << b) - 1, (unsigned long long)snapshot.histogram[b]);
+        }
+    }
+
+    printf(" PID  | Mapped Pages | Resident Pages\n");
+    printf("------+--------------+----------------\n");
+    std::vector<std::pair<uint32_t, PageTable*> > processes;
+    for (i = 0; i < _mmus.size(); i++)
+    {
+        std::vector<Process*> shard_processes = _mmus[i]->getProcesses();
+        for (j = 0; j < shard_processes.size(); j++)
+        {
+            processes.push_back(std::make_pair(shard_processes[j]->pid, _page_tables[i]));
+        }
+    }
+    std::sort(processes.begin(), processes.end());
+
+    for (i = 0; i < processes.size(); i++)
+    {
+        uint32_t mapped, resident;
+        processes[i].second->getProcessPages(processes[i].first, &mapped, &resident);
+        printf(" %4u | %12u | %14u \n", processes[i].first, mapped, resident);
+    }
+}
+
+bool StatsEngine::openSeries(std::string path)
+{
+    _series = fopen(path.c_str(), "w");
+    if (_series == NULL)
+    {
+        return false;
+    }
+
+    _format = (path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0) ? StatsJson : StatsCsv;
+    _samples = 0;
+    if (_format == StatsCsv)
+    {
+        fprintf(_series, "command,frames_used,frames_total,frame_utilization,mapped_pages,swapped_pages,resident_pages,"
+                         "untouched_pages,first_touch_faults,free_bytes,largest_hole,"
+                         "holes,external_fragmentation,internal_fragmentation,padding_bytes,rounding_bytes,unused_bytes,page_rounding\n");
+    }
+    else
+    {
+        fprintf(_series, "[");
+    }
+    return true;
+}
+
+bool StatsEngine::isRecording()
+{
+    return _series != NULL;
+}
+
+void StatsEngine::sample(uint64_t command)
+{
+    int b;
+    if (_series == NULL)
+    {
+        return;
+    }
+
+    MemorySnapshot s;
+    collect(command, &s);
+    if (_format == StatsCsv)
+    {
+        fprintf(_series, "%llu,%u,%u,%.4f,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%.4f,%.4f,%llu,%llu,%llu,%.4f\n",
+                (unsigned long long)s.command, s.frames_used, s.frames_total, s.frame_utilization,
+                (unsigned long long)s.mapped_pages, (unsigned long long)s.swapped_pages, (unsigned long long)s.resident_pages,
+                (unsigned long long)s.untouched_pages, (unsigned long long)s.first_touch_faults, (unsigned long long)s.free_bytes,
+                (unsigned long long)s.largest_hole, (unsigned long long)s.holes, s.external_fragmentation,
+                s.internal_fragmentation, (unsigned long long)s.padding_bytes, (unsigned long long)s.rounding_bytes,
+                (unsigned long long)s.unused_bytes, s.page_rounding);
+    }
+    else
+    {
+        fprintf(_series, "%s\n  {\"command\": %llu, \"frames_used\": %u, \"frames_total\": %u, \"frame_utilization\": %.4f, "
+                         "\"mapped_pages\": %llu, \"swapped_pages\": %llu, \"resident_pages\": %llu, \"untouched_pages\": %llu, "
+                         "\"first_touch_faults\": %llu, \"free_bytes\": %llu, \"largest_hole\": %llu, "
+                         "\"holes\": %llu, \"external_fragmentation\": %.4f, \"internal_fragmentation\": %.4f, "
+                         "\"padding_bytes\": %llu, \"rounding_bytes\": %llu, \"unused_bytes\": %llu, \"page_rounding\": %.4f, "
+                         "\"hole_histogram\": [",
+                _samples == 0 ? "" : ",", (unsigned long long)s.command, s.frames_used, s.frames_total, s.frame_utilization,
+                (unsigned long long)s.mapped_pages, (unsigned long long)s.swapped_pages, (unsigned long long)s.resident_pages,
+                (unsigned long long)s.untouched_pages, (unsigned long long)s.first_touch_faults, (unsigned long long)s.free_bytes,
+                (unsigned long long)s.largest_hole, (unsigned long long)s.holes, s.external_fragmentation,
+                s.internal_fragmentation, (unsigned long long)s.padding_bytes, (unsigned long long)s.rounding_bytes,
+                (unsigned long long)s.unused_bytes, s.page_rounding);
+
+        //histogram up to the largest bucket in use
+        int last = FREE_HISTOGRAM_BUCKETS - 1;
+        while (last >= 0 && s.histogram[last] == 0)
+        {
+            last--;
+        }
+        for (b = 0; b <= last; b++)
+        {
+            fprintf(_series, "%s%llu", b == 0 ? "" : ", ", (unsigned long long)s.histogram[b]);
+        }
+        fprintf(_series, "]}");
+    }
+    _samples++;
+}
+
+void StatsEngine::closeSeries()
+{
+    if (_series == NULL)
+    {
+        return;
+    }
+    if (_format == StatsJson)
+    {
+        fprintf(_series, "\n]\n");
+    }
+    fclose(_series);
+    _series = NULL;
+}
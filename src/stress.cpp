@@ -0,0 +1,138 @@
+#include <iostream>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <random>
+#include "stress.h"
+#include "pagetable.h"
+
+// processes alive at any time, each in its own slot readers pick from
+#define STRESS_SLOTS 64
+
+// pages per process, spread out so a process spans several leaves
+#define STRESS_PAGES 8
+#define STRESS_PAGE_STRIDE 200
+
+#define STRESS_FRAMES 4096
+
+typedef struct StressResult {
+    uint64_t reads;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t errors;
+} StressResult;
+
+static uint64_t signature(uint32_t pid, uint32_t page)
+{
+    return ((uint64_t)pid << 32) | page;
+}
+
+static void readMappings(PageTable *page_table, std::atomic<uint32_t> *slots, std::atomic<bool> *stop, uint32_t seed, StressResult *result)
+{
+    std::minstd_rand random(seed);
+    int page_size = page_table->getPageSize();
+    int reader = page_table->registerReader();
+
+    while (!stop->load(std::memory_order_relaxed))
+    {
+        uint32_t pid = slots[random() % STRESS_SLOTS].load(std::memory_order_acquire);
+        if (pid == 0)
+        {
+            continue;
+        }
+
+        uint32_t page = (random() % STRESS_PAGES) * STRESS_PAGE_STRIDE;
+        uint64_t value = 0;
+        result->reads++;
+        if (!page_table->readConcurrent(reader, pid, page * page_size, &value, sizeof(value)))
+        {
+            result->misses++;
+        }
+        else if (value != signature(pid, page))
+        {
+            result->errors++;
+        }
+        else
+        {
+            result->hits++;
+        }
+    }
+}
+
+bool runTranslationStress(int page_size, uint32_t num_readers, uint64_t operations)
+{
+    uint32_t i;
+    uint64_t op;
+    FrameAllocator frames(STRESS_FRAMES * page_size, page_size);
+    PageTable page_table(page_size, &frames, NULL, NULL, NULL);
+    page_table.enableConcurrentReaders();
+
+    //0 marks an empty slot, pids are never reused
+    std::atomic<uint32_t> slots[STRESS_SLOTS];
+    for (i = 0; i < STRESS_SLOTS; i++)
+    {
+        slots[i] = 0;
+    }
+
+    std::atomic<bool> stop(false);
+    std::vector<StressResult> results(num_readers, StressResult{0, 0, 0, 0});
+    std::vector<std::thread> readers;
+    for (i = 0; i < num_readers; i++)
+    {
+        readers.push_back(std::thread(readMappings, &page_table, slots, &stop, i + 1, &results[i]));
+    }
+
+    //the writer: fills empty slots with new processes, drops single pages or whole processes from full ones
+    std::minstd_rand random(0);
+    uint32_t next_pid = 1024;
+    uint64_t created = 0;
+    for (op = 0; op < operations; op++)
+    {
+        std::atomic<uint32_t> *slot = &slots[random() % STRESS_SLOTS];
+        uint32_t pid = slot->load(std::memory_order_relaxed);
+        if (pid == 0)
+        {
+            pid = next_pid++;
+            for (i = 0; i < STRESS_PAGES; i++)
+            {
+                uint64_t value = signature(pid, i * STRESS_PAGE_STRIDE);
+                page_table.addEntry(pid, i * STRESS_PAGE_STRIDE);
+                page_table.writeVirtual(pid, i * STRESS_PAGE_STRIDE * page_size, &value, sizeof(value));
+            }
+            slot->store(pid, std::memory_order_release);
+            created++;
+        }
+        else if (random() % 2 == 0)
+        {
+            page_table.removeEntry(pid, (random() % STRESS_PAGES) * STRESS_PAGE_STRIDE);
+        }
+        else
+        {
+            slot->store(0, std::memory_order_relaxed);
+            page_table.removeProcess(pid);
+        }
+    }
+
+    stop = true;
+    StressResult total = {0, 0, 0, 0};
+    for (i = 0; i < num_readers; i++)
+    {
+        readers[i].join();
+        total.reads += results[i].reads;
+        total.hits += results[i].hits;
+        total.misses += results[i].misses;
+        total.errors += results[i].errors;
+    }
+
+    EpochManager *epochs = page_table.getEpochs();
+    epochs->synchronize();
+    printf("Translation stress: %u readers, %llu writer operations, %llu processes\n", num_readers,
+           (unsigned long long)operations, (unsigned long long)created);
+    printf("  Reads:     %llu\n", (unsigned long long)total.reads);
+    printf("  Hits:      %llu\n", (unsigned long long)total.hits);
+    printf("  Misses:    %llu\n", (unsigned long long)total.misses);
+    printf("  Errors:    %llu\n", (unsigned long long)total.errors);
+    printf("  Reclaimed: %llu\n", (unsigned long long)epochs->getReclaimed());
+    printf("  Result:    %s\n", total.errors == 0 ? "PASS" : "FAIL");
+    return total.errors == 0;
+}
@@ -0,0 +1,83 @@
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include "swap.h"
+
+SwapSpace::SwapSpace(std::string path, uint32_t slot_size)
+{
+    _slot_size = slot_size;
+    _num_slots = 0;
+    _reads = 0;
+    _writes = 0;
+
+    //without a path the swap file is an anonymous temporary file
+    if (path.empty())
+    {
+        FILE *file = tmpfile();
+        _fd = file == NULL ? -1 : dup(fileno(file));
+        if (file != NULL)
+        {
+            fclose(file);
+        }
+    }
+    else
+    {
+        _fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+    }
+}
+
+SwapSpace::~SwapSpace()
+{
+    if (_fd >= 0)
+    {
+        close(_fd);
+    }
+}
+
+bool SwapSpace::isOpen()
+{
+    return _fd >= 0;
+}
+
+int SwapSpace::allocate()
+{
+    if (!_free_slots.empty())
+    {
+        uint32_t slot = _free_slots.back();
+        _free_slots.pop_back();
+        return slot;
+    }
+    return _num_slots++;
+}
+
+void SwapSpace::release(uint32_t slot)
+{
+    _free_slots.push_back(slot);
+}
+
+bool SwapSpace::write(uint32_t slot, const void *data)
+{
+    _writes++;
+    return pwrite(_fd, data, _slot_size, (off_t)slot * _slot_size) == (ssize_t)_slot_size;
+}
+
+bool SwapSpace::read(uint32_t slot, void *data)
+{
+    _reads++;
+    return pread(_fd, data, _slot_size, (off_t)slot * _slot_size) == (ssize_t)_slot_size;
+}
+
+uint32_t SwapSpace::getUsedSlots()
+{
+    return _num_slots - _free_slots.size();
+}
+
+uint64_t SwapSpace::getReads()
+{
+    return _reads;
+}
+
+uint64_t SwapSpace::getWrites()
+{
+    return _writes;
+}
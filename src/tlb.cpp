@@ -0,0 +1,265 @@
+#include "tlb.h"
+
+Tlb::Tlb(uint32_t num_entries, uint32_t ways, TlbPolicy policy)
+{
+    if (ways == 0 || ways > num_entries)
+    {
+        ways = num_entries;
+    }
+
+    //a TLB with no entries disables translation caching
+    _ways = ways;
+    _num_sets = (ways == 0) ? 0 : num_entries / ways;
+    _policy = policy;
+    _entries.assign(_num_sets * _ways, TlbEntry());
+    _clock_hands.assign(_num_sets, 0);
+    _tick = 0;
+    _large_pages = 0;
+
+    _hits = 0;
+    _misses = 0;
+    _shootdowns = 0;
+}
+
+Tlb::~Tlb()
+{
+}
+
+uint32_t Tlb::setIndex(uint32_t pid, uint32_t page)
+{
+    //mix in the pid so the same page of different processes spreads over the sets
+    return (page ^ (pid * 0x9E3779B1u)) % _num_sets;
+}
+
+uint32_t Tlb::chooseVictim(uint32_t set)
+{
+    TlbEntry *entries = &_entries[set * _ways];
+    uint32_t i;
+
+    //use an empty way if there is one
+    for (i = 0; i < _ways; i++)
+    {
+        if (!entries[i].valid)
+        {
+            return i;
+        }
+    }
+
+    if (_policy == TlbClock)
+    {
+        //second chance: clear reference bits until an unreferenced entry comes around
+        uint32_t &hand = _clock_hands[set];
+        while (entries[hand].referenced)
+        {
+            entries[hand].referenced = false;
+            hand = (hand + 1) % _ways;
+        }
+        uint32_t victim = hand;
+        hand = (hand + 1) % _ways;
+        return victim;
+    }
+
+    uint32_t victim = 0;
+    for (i = 1; i < _ways; i++)
+    {
+        if (entries[i].last_used < entries[victim].last_used)
+        {
+            victim = i;
+        }
+    }
+    return victim;
+}
+
+//entry in the set of first_page that maps page
+TlbEntry* Tlb::find(uint32_t pid, uint32_t first_page, uint32_t page)
+{
+    TlbEntry *entries = &_entries[setIndex(pid, first_page) * _ways];
+    for (uint32_t i = 0; i < _ways; i++)
+    {
+        if (entries[i].valid && entries[i].page == first_page && entries[i].pid == pid && page - first_page < entries[i].pages)
+        {
+            return &entries[i];
+        }
+    }
+    return NULL;
+}
+
+bool Tlb::lookup(uint32_t pid, uint32_t page, uint32_t *frame)
+{
+    if (_entries.empty())
+    {
+        _misses++;
+        return false;
+    }
+
+    //a page of a large page is found in the set of the large page's first page
+    TlbEntry *entry = find(pid, page, page);
+    if (entry == NULL && _large_pages != 0)
+    {
+        entry = find(pid, page - page % _large_pages, page);
+    }
+    if (entry == NULL)
+    {
+        _misses++;
+        return false;
+    }
+
+    entry->referenced = true;
+    entry->last_used = ++_tick;
+    *frame = entry->frame + (page - entry->page);
+    _hits++;
+    return true;
+}
+
+void Tlb::fill(uint32_t pid, uint32_t page, uint32_t frame, uint32_t pages)
+{
+    if (_entries.empty())
+    {
+        return;
+    }
+
+    uint32_t set = setIndex(pid, page);
+    TlbEntry *entry = &_entries[set * _ways + chooseVictim(set)];
+    entry->valid = true;
+    entry->referenced = true;
+    entry->pid = pid;
+    entry->page = page;
+    entry->frame = frame;
+    entry->pages = pages;
+    entry->last_used = ++_tick;
+}
+
+void Tlb::insert(uint32_t pid, uint32_t page, uint32_t frame)
+{
+    fill(pid, page, frame, 1);
+}
+
+void Tlb::insertLarge(uint32_t pid, uint32_t first_page, uint32_t first_frame, uint32_t pages)
+{
+    _large_pages = pages;
+    fill(pid, first_page, first_frame, pages);
+}
+
+void Tlb::invalidate(uint32_t pid, uint32_t page)
+{
+    if (_entries.empty())
+    {
+        return;
+    }
+
+    _shootdowns++;
+    TlbEntry *entry = find(pid, page, page);
+    if (entry != NULL)
+    {
+        entry->valid = false;
+    }
+    if (_large_pages != 0)
+    {
+        entry = find(pid, page - page % _large_pages, page);
+        if (entry != NULL)
+        {
+            entry->valid = false;
+        }
+    }
+}
+
+void Tlb::flush(uint32_t pid)
+{
+    if (_entries.empty())
+    {
+        return;
+    }
+
+    _shootdowns++;
+    for (uint32_t i = 0; i < _entries.size(); i++)
+    {
+        if (_entries[i].pid == pid)
+        {
+            _entries[i].valid = false;
+        }
+    }
+}
+
+uint32_t Tlb::getNumEntries()
+{
+    return _entries.size();
+}
+
+uint64_t Tlb::getHits()
+{
+    return _hits;
+}
+
+uint64_t Tlb::getMisses()
+{
+    return _misses;
+}
+
+uint64_t Tlb::getShootdowns()
+{
+    return _shootdowns;
+}
+
+double Tlb::getHitRate()
+{
+    uint64_t lookups = _hits + _misses;
+    return lookups == 0 ? 0.0 : (double)_hits / lookups;
+}
+
+void Tlb::print(int page_size)
+{
+    print(std::vector<Tlb*>(1, this), page_size);
+}
+
+//every shard has its own TLB, like every core has its own
+void Tlb::print(const std::vector<Tlb*>& tlbs, int page_size)
+{
+    int i;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t shootdowns = 0;
+    for (i = 0; i < tlbs.size(); i++)
+    {
+        hits += tlbs[i]->_hits;
+        misses += tlbs[i]->_misses;
+        shootdowns += tlbs[i]->_shootdowns;
+    }
+
+    Tlb *first = tlbs[0];
+    uint64_t lookups = hits + misses;
+    printf("TLB entries:  %u (%u sets x %u ways, %s)\n", first->getNumEntries(), first->_num_sets, first->_ways, first->_policy == TlbClock ? "clock" : "lru");
+    if (tlbs.size() > 1)
+    {
+        printf("TLBs:         %zu (one per shard)\n", tlbs.size());
+    }
+    printf("TLB reach:    %llu bytes\n", (unsigned long long)first->getNumEntries() * page_size);
+    if (first->_large_pages != 0)
+    {
+        //what the entries map right now, large page entries included
+        uint64_t mapped = 0;
+        for (i = 0; i < first->_entries.size(); i++)
+        {
+            mapped += first->_entries[i].valid ? first->_entries[i].pages : 0;
+        }
+        printf("Reach in use: %llu bytes\n", (unsigned long long)mapped * page_size);
+    }
+    printf("Hits:         %llu\n", (unsigned long long)hits);
+    printf("Misses:       %llu\n", (unsigned long long)misses);
+    printf("Hit rate:     %.2f%%\n", lookups == 0 ? 0.0 : 100.0 * hits / lookups);
+    printf("Shootdowns:   %llu\n", (unsigned long long)shootdowns);
+}
+
+TlbPolicy stringToTlbPolicy(std::string text, bool *valid)
+{
+    *valid = true;
+    if (text == "lru" || text == "LRU")
+    {
+        return TlbLru;
+    }
+    if (text == "clock" || text == "Clock")
+    {
+        return TlbClock;
+    }
+    *valid = false;
+    return TlbLru;
+}
@@ -0,0 +1,146 @@
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include "traceio.h"
+
+LineReader::LineReader(int fd, bool owns_fd, size_t block_size)
+{
+    _fd = fd;
+    _owns_fd = owns_fd;
+    _eof = false;
+    _buffer.resize(block_size);
+    _start = 0;
+    _end = 0;
+}
+
+LineReader::~LineReader()
+{
+    if (_owns_fd)
+    {
+        close(_fd);
+    }
+}
+
+bool LineReader::fill()
+{
+    //move the unfinished line to the front, growing the buffer if a single line fills it
+    if (_start > 0)
+    {
+        memmove(&_buffer[0], &_buffer[_start], _end - _start);
+        _end -= _start;
+        _start = 0;
+    }
+    if (_end == _buffer.size())
+    {
+        _buffer.resize(_buffer.size() * 2);
+    }
+
+    ssize_t count = read(_fd, &_buffer[_end], _buffer.size() - _end);
+    if (count <= 0)
+    {
+        _eof = true;
+        return false;
+    }
+    _end += count;
+    return true;
+}
+
+bool LineReader::nextLine(std::string& line)
+{
+    size_t scanned = _start;
+    while (true)
+    {
+        char *newline = (char*)memchr(&_buffer[0] + scanned, '\n', _end - scanned);
+        if (newline != NULL)
+        {
+            size_t position = newline - &_buffer[0];
+            line.assign(&_buffer[_start], position - _start);
+            _start = position + 1;
+            return true;
+        }
+
+        scanned = _end - _start;
+        if (_eof || !fill())
+        {
+            break;
+        }
+    }
+
+    //last line without a trailing newline
+    if (_start < _end)
+    {
+        line.assign(&_buffer[_start], _end - _start);
+        _start = _end;
+        return true;
+    }
+    return false;
+}
+
+int StdioOutput::overflow(int c)
+{
+    if (c != EOF)
+    {
+        putchar(c);
+    }
+    return c;
+}
+
+std::streamsize StdioOutput::xsputn(const char *s, std::streamsize n)
+{
+    return fwrite(s, 1, n, stdout);
+}
+
+int StdioOutput::sync()
+{
+    return 0;
+}
+
+int NullOutput::overflow(int c)
+{
+    return c;
+}
+
+std::streamsize NullOutput::xsputn(const char *s, std::streamsize n)
+{
+    return n;
+}
+
+StringOutput::StringOutput()
+{
+    _target = NULL;
+}
+
+void StringOutput::setTarget(std::string *target)
+{
+    _target = target;
+}
+
+int StringOutput::overflow(int c)
+{
+    if (c != EOF)
+    {
+        _target->push_back((char)c);
+    }
+    return c;
+}
+
+std::streamsize StringOutput::xsputn(const char *s, std::streamsize n)
+{
+    _target->append(s, n);
+    return n;
+}
+
+LineReader* openTrace(std::string path)
+{
+    if (path == "-")
+    {
+        return new LineReader(STDIN_FILENO, false, 1 << 20);
+    }
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return NULL;
+    }
+    return new LineReader(fd, true, 1 << 20);
+}
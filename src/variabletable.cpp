@@ -0,0 +1,124 @@
+#include "variabletable.h"
+
+VariableTable::VariableTable()
+{
+    _removed_rows = 0;
+}
+
+VariableTable::~VariableTable()
+{
+}
+
+void VariableTable::add(std::string_view name, DataType type, uint32_t address, uint32_t size, uint32_t padding, uint32_t reserved)
+{
+    uint32_t id;
+    if (_free_ids.empty())
+    {
+        id = _names.size();
+        _names.push_back(name);
+        _rows.push_back(0);
+    }
+    else
+    {
+        id = _free_ids.back();
+        _free_ids.pop_back();
+        _names[id] = name;
+    }
+
+    _rows[id] = _addresses.size();
+    _name_index[name] = id;
+    _addresses.push_back(address);
+    _sizes.push_back(size);
+    _types.push_back(type);
+    _name_ids.push_back(id);
+    _paddings.push_back(padding);
+    _reserved.push_back(reserved);
+}
+
+bool VariableTable::find(std::string_view name, Variable *var)
+{
+    std::unordered_map<std::string_view, uint32_t>::iterator it = _name_index.find(name);
+    if (it == _name_index.end())
+    {
+        return false;
+    }
+
+    getRow(_rows[it->second], var);
+    return true;
+}
+
+bool VariableTable::remove(std::string_view name, Variable *removed)
+{
+    std::unordered_map<std::string_view, uint32_t>::iterator it = _name_index.find(name);
+    if (it == _name_index.end())
+    {
+        return false;
+    }
+
+    uint32_t id = it->second;
+    uint32_t row = _rows[id];
+    getRow(row, removed);
+
+    _name_index.erase(it);
+    _names[id] = std::string_view();
+    _free_ids.push_back(id);
+    _name_ids[row] = VARIABLE_REMOVED;
+    _removed_rows++;
+
+    if (_removed_rows > _addresses.size() / 2)
+    {
+        compact();
+    }
+    return true;
+}
+
+//drops removed rows, keeping the others in order
+void VariableTable::compact()
+{
+    size_t i;
+    size_t live = 0;
+    for (i = 0; i < _addresses.size(); i++)
+    {
+        if (_name_ids[i] == VARIABLE_REMOVED)
+        {
+            continue;
+        }
+        _addresses[live] = _addresses[i];
+        _sizes[live] = _sizes[i];
+        _types[live] = _types[i];
+        _name_ids[live] = _name_ids[i];
+        _paddings[live] = _paddings[i];
+        _reserved[live] = _reserved[i];
+        _rows[_name_ids[live]] = live;
+        live++;
+    }
+
+    _addresses.resize(live);
+    _sizes.resize(live);
+    _types.resize(live);
+    _name_ids.resize(live);
+    _paddings.resize(live);
+    _reserved.resize(live);
+    _removed_rows = 0;
+}
+
+uint32_t VariableTable::getRowCount()
+{
+    return _addresses.size();
+}
+
+bool VariableTable::getRow(uint32_t row, Variable *var)
+{
+    if (_name_ids[row] == VARIABLE_REMOVED)
+    {
+        return false;
+    }
+
+    var->name = _names[_name_ids[row]];
+    var->type = _types[row];
+    var->virtual_address = _addresses[row];
+    var->size = _sizes[row];
+    var->padding = _paddings[row];
+    var->reserved = _reserved[row];
+    return true;
+}
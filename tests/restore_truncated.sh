@@ -0,0 +1,33 @@
+#!/bin/sh
+# Restoring a truncated snapshot must fail without touching the running
+# processes: they keep their variables and the next pid stays the same.
+MEMSIM=${MEMSIM:-./bin/memsim}
+DIR=$(mktemp -d)
+trap 'rm -rf "$DIR"' EXIT
+
+printf 'create 2048 1024\nallocate 1024 a int 4\nset 1024 a 0 1 2 3\nsnapshot %s/full.snap\n' "$DIR" \
+    | "$MEMSIM" 4096 --batch > /dev/null 2>&1 || exit 1
+
+# one cut inside the memory image, one inside the metadata
+cp "$DIR/full.snap" "$DIR/image.snap"
+truncate -s 70000 "$DIR/image.snap"
+head -c 100 "$DIR/full.snap" > "$DIR/meta.snap"
+truncate -s 70000 "$DIR/meta.snap"
+
+for snap in image meta; do
+    output=$(printf 'create 2048 1024\ncreate 2048 1024\nallocate 1025 b int 2\nset 1025 b 0 7 8\nrestore %s/%s.snap\nprint 1025:b\ncreate 2048 1024\n' "$DIR" "$snap" \
+        | "$MEMSIM" 4096 --batch 2> /dev/null)
+    expected="1024
+1025
+68608
+error: could not restore snapshot '$DIR/$snap.snap'
+PID: 1025 varName: b
+7, 8
+1026"
+    if [ "$output" != "$expected" ]; then
+        echo "FAIL: restore of a truncated snapshot ($snap) changed the running processes"
+        echo "$output"
+        exit 1
+    fi
+done
+echo "PASS: restore_truncated"